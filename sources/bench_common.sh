@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# Helpers of the bench_*.sh scripts, sourced after they set script_dir.
+# DATASETS is the directory of the datasets, SYN by default, and K the size of the kmers.
+
+datasets=${DATASETS:-$script_dir/../../datasets/SYN}
+k=${K:-14}
+
+# Wall time of a command in seconds, its output is discarded
+elapsed() {
+    local start=$(date +%s.%N)
+    "$@" > /dev/null
+    local end=$(date +%s.%N)
+    echo "$end - $start" | bc
+}
+
+# Fasta files of the datasets, in natural order
+fastas() {
+    ls $datasets/*.fasta | sort -V
+}
+
+# Kmers and the n seeds of one dataset, and their siblings at distance d if d is given
+prepare() {
+    local fasta=$1 n=$2 d=$3
+    smt -i $fasta -k $k > /dev/null
+    hmap -n $n
+    if [ -n "$d" ]; then
+        kdive -kmers smt_data/kmers.txt -d $d > /dev/null
+    fi
+}
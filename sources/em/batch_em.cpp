@@ -0,0 +1,149 @@
+#include "batch_em.h"
+#include "prob_utils.h"
+
+//'Runs Expectation Maximization OOPS, ZOOPS or ANR for many models in a single pass over the data.
+//'Each sequence is scored against all active models while it is in cache, and models that
+//'converged stop being scored.
+//'@name batch_em
+//'@param fasta Encoded dataset of sequences.
+//'@param alphas PWM models to be reestimated, one slice per model.
+//'@param beta Markov model thats represents the control senquences.
+//'@param cutoff Cutoff for EM convergence.
+//'@param niter Maximum number of iterations.
+//'@param w Initial priori probability, 1 for OOPS.
+//'@param mod Can be OOPS, ZOOPS or ANR.
+//'@param overlap ANR only, do not let overlapping sites sum more than 1.
+//'@param strands STRAND_FORWARD, STRAND_BOTH or STRAND_PALINDROME, OOPS and ZOOPS only.
+//'@return Updated PWM models.
+arma::cube batch_em(const EncodedFasta &fasta, arma::cube alphas, const arma::mat &beta, const double cutoff, int niter, const double w, const std::string &mod, const bool overlap, const int strands) {
+  /**
+   * Parameters
+   */
+  const int k = alphas.n_cols;
+  const int nmodels = alphas.n_slices;
+  const bool zoops = mod == "ZOOPS";
+  const bool anr = mod == "ANR";
+  const bool both = !anr && strands != STRAND_FORWARD;
+  
+  /**
+   * Models to reestimate
+   */
+  arma::cube alphalogs(4, k, nmodels);
+  arma::cube alphalogs_rc(4, k, nmodels);
+  arma::mat rc(4, k);
+  arma::vec ws(nmodels);
+  ws.fill(w);
+  
+  /**
+   * Background log-probabilities, fixed during EM
+   */
+  const Background bg = backgroundPrefixes(fasta, beta);
+  
+  /**
+   * Accumulators of each chunk of sequences of similar length, folded in order
+   */
+  const std::vector<size_t> lengths = sequenceLengths(fasta);
+  const std::vector<size_t> order = lengthOrder(lengths, k);
+  const size_t n = order.size();
+  const size_t chunk = std::max<size_t>(EM_CHUNK, (n + BATCH_CHUNKS - 1) / BATCH_CHUNKS);
+  const std::vector<size_t> bounds = lengthBatches(lengths, order, k, chunk);
+  const size_t nchunks = bounds.empty() ? 0 : bounds.size() - 1;
+  double positions = 0.0;
+  for (const auto i : order) positions += lengths[i] - k + 1;
+  std::vector<arma::cube> counts(nchunks, arma::cube(4, k, nmodels));
+  std::vector<arma::cube> counts_rc(both ? nchunks : 0, arma::cube(4, k, nmodels));
+  std::vector<arma::vec> sumz(nchunks, arma::vec(nmodels));
+  std::vector<std::vector<double>> z(nchunks);
+  for (size_t c = 0; c < nchunks; ++c) {
+    size_t t = k;
+    for (size_t p = bounds[c]; p < bounds[c + 1]; ++p) t = std::max(t, lengths[order[p]]);
+    z[c].resize(2 * (t - k + 1));
+  }
+  
+  /**
+   * Convergence control of each model
+   */
+  std::vector<std::vector<double>> convergence(nmodels);
+  std::vector<std::vector<double>> changes(nmodels);
+  std::vector<int> active, still_active;
+  active.reserve(nmodels);
+  still_active.reserve(nmodels);
+  for (int a = 0; a < nmodels; ++a) {
+    convergence[a].reserve(niter + 2);
+    changes[a].reserve(niter + 2);
+    convergence[a].push_back(-std::numeric_limits<double>::infinity());
+    changes[a].push_back(0);
+    active.push_back(a);
+  }
+  
+  while (!active.empty()) {
+    for (const int a : active) {
+      logModel(alphas.slice(a), alphalogs.slice(a));
+      if (both) alpha2rc(alphalogs.slice(a), alphalogs_rc.slice(a));
+    }
+    
+    /**
+     * E-STEP and M-STEP counts, parallel across sequences
+     */
+    tbb::parallel_for(size_t(0), nchunks, [&](size_t c) {
+      for (const int a : active) counts[c].slice(a).zeros();
+      if (both) for (const int a : active) counts_rc[c].slice(a).zeros();
+      sumz[c].zeros();
+      
+      for (size_t p = bounds[c]; p < bounds[c + 1]; ++p) {
+        const size_t i = order[p];
+        const uint8_t *seq = fasta.seq(i);
+        const double *prefix = bg.seq(i);
+        const int t = fasta.length(i);
+        const int m = t - k + 1;
+        
+        double *zc = z[c].data();
+        for (const int a : active) {
+          if (anr) anrPosterior(seq, prefix, t, alphalogs.slice(a).memptr(), k, ws[a], overlap, zc);
+          else posterior(seq, prefix, t, alphalogs.slice(a).memptr(), both ? alphalogs_rc.slice(a).memptr() : nullptr, k, ws[a], zoops, false, zc);
+          double s = 0.0;
+          for (int j = 0; j < (both ? 2 * m : m); ++j) s += zc[j];
+          sumz[c][a] += s;
+          update(counts[c].slice(a), seq, t, zc);
+          if (both) update(counts_rc[c].slice(a), seq, t, zc + m);
+        }
+      }
+    });
+    
+    still_active.clear();
+    for (const int a : active) {
+      arma::mat &alpha = alphas.slice(a);
+      alpha.fill(1e-100);
+      double new_w = 0.0;
+      for (size_t c = 0; c < nchunks; ++c) {
+        alpha += counts[c].slice(a);
+        if (both) {
+          alpha2rc(counts_rc[c].slice(a), rc);
+          alpha += rc;
+        }
+        new_w += sumz[c][a];
+      }
+      if (!anr && strands == STRAND_PALINDROME) {
+        alpha2rc(alpha, rc);
+        alpha += rc;
+        alpha /= 2;
+      }
+      normalizeModel(alpha, alpha);
+      if (zoops) ws[a] = new_w / n;
+      if (anr) ws[a] = new_w / positions;
+      
+      /**
+       * Convergence control
+       */
+      if (!hasConverged(cutoff, niter, alpha, convergence[a], changes[a])) still_active.push_back(a);
+    }
+    active.swap(still_active);
+    
+    /**
+     * Next iteration
+     */
+    --niter;
+  }
+  
+  return alphas;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <string>
+#include <tbb/parallel_for.h>
+#include <tbb/tbb.h>
+#include "utils.h"
+
+#define BATCH_CHUNKS 256
+
+arma::cube batch_em(const EncodedFasta &fasta, arma::cube alphas, const arma::mat &beta, const double cutoff, int niter, const double w, const std::string &mod, const bool overlap, const int strands);
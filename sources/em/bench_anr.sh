@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Benchmark of the ANR EM against ZOOPS on the SYN datasets.
+# Run it from an empty directory with smt, hmap, kdive and em in the PATH.
+# Output: dataset type seconds
+
+script_dir=$(cd "$(dirname "$0")" && pwd)
+source "$script_dir/../bench_common.sh"
+n=${N:-30}
+d=${D:-2}
+niter=${NITER:-100}
+cutoff=${CUTOFF:-0.0001}
+
+echo -e "dataset\ttype\tseconds"
+for fasta in $(fastas); do
+    name=$(basename $fasta .fasta)
+    prepare $fasta $n $d
+
+    echo -e "$name\tzoops\t$(elapsed em -i $fasta -type zoops -k $k -niter $niter -cutoff $cutoff -n $n)"
+    echo -e "$name\tanr\t$(elapsed em -i $fasta -type anr -k $k -niter $niter -cutoff $cutoff -n $n)"
+    echo -e "$name\tanr-overlap\t$(elapsed em -i $fasta -type anr -k $k -niter $niter -cutoff $cutoff -n $n -overlap 1)"
+done
@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Time of compare against a motif database in JASPAR format, for each metric.
+# Run it from a directory with smt_data/models, after em, with compare in the PATH.
+# DB is the database, e.g. the JASPAR CORE non-redundant file of all taxa.
+# Output: metric models seconds seconds_per_model
+
+script_dir=$(cd "$(dirname "$0")" && pwd)
+source "$script_dir/../bench_common.sh"
+db=${DB:?DB precisa apontar para um arquivo JASPAR}
+models=${MODELS:-smt_data/models}
+
+n=$(ls $models | grep -v -E '\.(png|svg|txt)$' | wc -l)
+echo -e "metric\tmodels\tseconds\tseconds_per_model"
+for metric in pcc ed kl; do
+    seconds=$(elapsed compare -db $db -models $models -metric $metric -o matches.tsv)
+    echo -e "$metric\t$n\t$seconds\t$(echo "scale=4; $seconds / $n" | bc)"
+done
@@ -0,0 +1,25 @@
+#!/bin/bash
+
+# Throughput of scan on the SYN datasets, with the models of em.
+# Run it from an empty directory with smt, hmap, kdive, em and scan in the PATH.
+# Output: dataset pvalue tau sites seconds
+
+script_dir=$(cd "$(dirname "$0")" && pwd)
+source "$script_dir/../bench_common.sh"
+n=${N:-10}
+d=${D:-2}
+niter=${NITER:-100}
+cutoff=${CUTOFF:-0.0001}
+pvalue=${PVALUE:-0.0001}
+
+echo -e "dataset\tpvalue\ttau\tsites\tseconds"
+for fasta in $(fastas); do
+    name=$(basename $fasta .fasta)
+    prepare $fasta $n $d
+    em -i $fasta -type zoops -k $k -niter $niter -cutoff $cutoff -n $n > /dev/null
+
+    for tau in 0 2; do
+        seconds=$(elapsed scan -i $fasta -pvalue $pvalue -tau $tau -o sites.bed)
+        echo -e "$name\t$pvalue\t$tau\t$(wc -l < sites.bed)\t$seconds"
+    done
+done
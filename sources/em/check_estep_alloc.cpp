@@ -0,0 +1,137 @@
+#include "prob_utils.h"
+#include "utils.h"
+#include "oops.h"
+#include "squarem.h"
+#include "batch_em.h"
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <new>
+#include <cerrno>
+
+// Heap allocations of the E-step and of the EM iterations. The global operator new is
+// replaced, and so are the glibc malloc entry points, since armadillo takes its memory
+// from malloc and posix_memalign. Allocations are only counted while counting is set.
+// A loop is measured by running it twice with a different number of iterations, its
+// setup allocates the same in both runs, so any difference is allocated per iteration.
+// Uso: check_estep_alloc [fasta] [consensus]
+// Output: loop allocations per iteration, exit 1 if any is not 0
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+static std::atomic<bool> counting(false);
+static std::atomic<size_t> allocations(0);
+
+static inline void count() {
+  if (counting.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<class F> static size_t countAllocations(F run) {
+  allocations = 0;
+  counting = true;
+  run();
+  counting = false;
+  return allocations;
+}
+
+extern "C" {
+void *malloc(size_t size) { count(); return __libc_malloc(size); }
+void *calloc(size_t n, size_t size) { count(); return __libc_calloc(n, size); }
+void *realloc(void *ptr, size_t size) { count(); return __libc_realloc(ptr, size); }
+void *memalign(size_t alignment, size_t size) { count(); return __libc_memalign(alignment, size); }
+void *aligned_alloc(size_t alignment, size_t size) { count(); return __libc_memalign(alignment, size); }
+void free(void *ptr) { __libc_free(ptr); }
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+  count();
+  void *p = __libc_memalign(alignment, size);
+  if (p == nullptr) return ENOMEM;
+  *ptr = p;
+  return 0;
+}
+}
+
+void *operator new(size_t size) {
+  count();
+  if (void *p = __libc_malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { __libc_free(ptr); }
+void operator delete[](void *ptr) noexcept { __libc_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { __libc_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { __libc_free(ptr); }
+
+int main(int argc, char *argv[]) {
+  
+  const std::string path = argc > 1 ? argv[1] : "../../MA0003.4.fasta.masked.dust";
+  const std::string consensus = argc > 2 ? argv[2] : "GCCTGAGGC";
+  
+  const std::vector<std::string> data = readFasta(path);
+  if (data.empty()) {
+    std::cerr << "Fasta vazio ou inexistente: " << path << "\n";
+    return 1;
+  }
+  
+  const EncodedFasta fasta = encodeFasta(data);
+  const arma::mat beta = createMarkovChain(data, 0);
+  const Background bg = backgroundPrefixes(fasta, beta);
+  const arma::mat alphalog = arma::log(consensus2alpha(consensus));
+  const int k = alphalog.n_cols;
+  
+  const char *names[3] = {"forward", "both", "palindrome"};
+  size_t failures = 0;
+  std::cout << "loop\tallocations\n";
+  
+  // Allocations of each iteration of a loop, from runs of short and long iterations
+  auto report = [&](const std::string &loop, const double n) {
+    std::cout << loop << "\t" << n << "\n";
+    if (n != 0) ++failures;
+  };
+  
+  for (int strands = STRAND_FORWARD; strands <= STRAND_PALINDROME; ++strands) {
+    EMWorkspace ws = createWorkspace(fasta, k, strands);
+    arma::mat new_alpha(4, k);
+    double new_w = 0.0;
+  
+    /**
+     * The first call warms up the thread pool, the second one is counted
+     */
+    estep(fasta, bg, alphalog, 0.5, false, false, ws, new_alpha, new_w);
+    report(std::string("estep ") + names[strands], countAllocations([&] { estep(fasta, bg, alphalog, 0.5, false, false, ws, new_alpha, new_w); }));
+  }
+  
+  /**
+   * Whole EM runs, a cutoff of -1 never converges so each runs niter + 1 iterations
+   */
+  const arma::mat alpha = consensus2alpha(consensus);
+  for (int strands = STRAND_FORWARD; strands <= STRAND_PALINDROME; ++strands) {
+    auto run = [&](const int niter) { return countAllocations([&] { oops(fasta, alpha, beta, -1, niter, 1.0, strands); }); };
+    const double few = run(2), many = run(6);
+    report(std::string("oops ") + names[strands], (many - few) / 4);
+  }
+  
+  auto squarem_run = [&](const int niter) {
+    std::vector<SquaremTrace> trace;
+    return countAllocations([&] { squarem(fasta, alpha, beta, -1, niter, 0.5, true, STRAND_BOTH, trace); });
+  };
+  const double few = squarem_run(6), many = squarem_run(15);
+  report("squarem cycle", (many - few) / 3);
+  
+  arma::cube alphas(4, k, 3);
+  for (int a = 0; a < 3; ++a) alphas.slice(a) = alpha;
+  for (const std::string mod : {"OOPS", "ZOOPS", "ANR"}) {
+    auto run = [&](const int niter) { return countAllocations([&] { batch_em(fasta, alphas, beta, -1, niter, 0.5, mod, mod == "ANR", STRAND_BOTH); }); };
+    const double few = run(2), many = run(6);
+    report("batch_em " + mod, (many - few) / 4);
+  }
+  
+  return failures > 0 ? 1 : 0;
+}
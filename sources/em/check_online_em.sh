@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# Agreement of online EM with full EM. Runs oops over the whole fasta and oops -batch
+# streaming it, from the same start and seed, and fails if some probability of the two
+# PWMs differs by more than TOL.
+# Run it from an empty directory with oops in the PATH.
+# Output: batch epochs max_diff, exit 1 if max_diff > TOL
+
+script_dir=$(cd "$(dirname "$0")" && pwd)
+fasta=${FASTA:-$script_dir/../../MA0003.4.fasta.masked.dust}
+start=${START:-GCCTGAGGC}
+batch=${BATCH:-500}
+niter=${NITER:-20}
+cutoff=${CUTOFF:-0.000001}
+seed=${SEED:-1}
+tol=${TOL:-0.01}
+
+oops -i $fasta -start $start -niter $niter -cutoff $cutoff -seed $seed > /dev/null || exit 1
+cp oops/models/m1 full.csv
+oops -i $fasta -start $start -niter $niter -cutoff $cutoff -seed $seed -batch $batch > /dev/null || exit 1
+cp oops/models/m1 online.csv
+
+# Max absolute difference over all cells of the two csv files
+diff=$(paste -d, full.csv online.csv | awk -F, '{
+    n = NF / 2
+    for (i = 1; i <= n; ++i) { d = $i - $(i + n); if (d < 0) d = -d; if (d > max) max = d }
+  } END { printf "%.6f", max }')
+
+echo -e "batch\tepochs\tmax_diff"
+echo -e "$batch\t$niter\t$diff"
+awk -v d=$diff -v t=$tol 'BEGIN { exit !(d <= t) }' || { echo "PWMs differ by more than $tol" >&2; exit 1; }
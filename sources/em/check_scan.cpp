@@ -0,0 +1,137 @@
+#include "scan.h"
+#include "prob_utils.h"
+#include "utils.h"
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+// Score distribution of scan against brute force enumeration. For small k and tau every
+// context and window is enumerated with its probability, which gives the exact tail
+// P(S >= s). Each column adds at most eps/2 of rounding, so with h = (k + 1) / 2 * eps
+//   exact(s + h) <= scorePvalue(s) <= exact(s - h)   and   exact(threshold + h) <= pvalue,
+// and h itself must stay under CHECK_MARGIN nats, a grid of floored models is fine.
+// Uso: check_scan [fasta]
+// Output: model tau k eps margin, exit 1 if a bound fails
+
+#define CHECK_MARGIN 0.1
+#define CHECK_SLACK 1e-9
+
+struct Window {
+  double score;
+  double p;
+};
+
+// Every context and window with its score and probability, as in scoreDistribution
+static void enumerateWindows(const arma::mat &alphalog, const std::vector<arma::mat> &tables, std::vector<Window> &windows) {
+  const int k = alphalog.n_cols;
+  const int tau = tables.size() - 1;
+  const size_t contexts = size_t(1) << (2 * tau);
+  const size_t mask = contexts - 1;
+  const arma::mat &trans = tables[tau];
+  const size_t nwindows = size_t(1) << (2 * k);
+  windows.clear();
+  
+  for (size_t s = 0; s < contexts; ++s) {
+    double logp = 0.0;
+    for (int l = 0; l < tau; ++l) logp += tables[l](s >> (2 * (tau - l)), (s >> (2 * (tau - 1 - l))) & 3);
+  
+    for (size_t x = 0; x < nwindows; ++x) {
+      size_t context = s;
+      double score = 0.0, lp = logp;
+      for (int l = 0; l < k; ++l) {
+        const int c = (x >> (2 * (k - 1 - l))) & 3;
+        score += alphalog(c, l) - trans(context, c);
+        lp += trans(context, c);
+        context = ((context << 2) | c) & mask;
+      }
+      windows.push_back({score, std::exp(lp)});
+    }
+  }
+  
+  std::sort(windows.begin(), windows.end(), [](const Window &a, const Window &b) { return a.score > b.score; });
+  for (size_t i = 1; i < windows.size(); ++i) windows[i].p += windows[i - 1].p;
+}
+
+// P(S >= s) from the windows sorted by decreasing score with cumulative probabilities
+static double exactTail(const std::vector<Window> &windows, const double s) {
+  auto it = std::partition_point(windows.begin(), windows.end(), [&](const Window &w) { return w.score >= s; });
+  return it == windows.begin() ? 0.0 : (it - 1)->p;
+}
+
+int main(int argc, char *argv[]) {
+  
+  const std::string path = argc > 1 ? argv[1] : "../../MA0003.4.fasta.masked.dust";
+  const std::vector<std::string> fasta = readFasta(path);
+  if (fasta.empty()) {
+    std::cerr << "Fasta vazio ou inexistente: " << path << "\n";
+    return 1;
+  }
+  
+  /**
+   * A consensus model, and the same model with the 1e-100 floors EM writes
+   */
+  const arma::mat consensus = consensus2alpha("GCCTGAGG");
+  arma::mat sparse = consensus;
+  for (size_t l = 0; l < sparse.n_cols; ++l) {
+    for (int c = 0; c < 4; ++c) if (sparse(c, l) < .5 && c != int(l % 4)) sparse(c, l) = 1e-100;
+    sparse.col(l) /= arma::accu(sparse.col(l));
+  }
+  const std::vector<std::pair<std::string, arma::mat>> models = {{"consensus", consensus}, {"sparse", sparse}};
+  const double pvalues[4] = {1e-2, 1e-3, 1e-4, 1e-5};
+  
+  size_t failures = 0;
+  std::cout << "model\ttau\tk\teps\tmargin\n";
+  
+  for (int tau = 0; tau <= 2; ++tau) {
+    // An unseen transition, clamped by the background as in a real dataset
+    arma::mat raw = createMarkovChain(fasta, tau);
+    raw(0, 3) = 1e-300;
+    const std::vector<arma::mat> tables = backgroundTables(floorChain(raw));
+  
+    for (const auto &model : models) {
+      const arma::mat alphalog = arma::log(floorModel(model.second));
+      const int k = alphalog.n_cols;
+      const ScoreDistribution dist = scoreDistribution(alphalog, tables);
+      const double h = (k + 1) / 2.0 * dist.eps;
+  
+      std::vector<Window> windows;
+      enumerateWindows(alphalog, tables, windows);
+  
+      /**
+       * Thresholds: no score past the rounding margin may be more frequent than pvalue
+       */
+      for (const double pvalue : pvalues) {
+        const double threshold = scoreThreshold(dist, pvalue);
+        if (exactTail(windows, threshold + h) > pvalue * (1 + CHECK_SLACK)) {
+          std::cerr << model.first << " tau " << tau << ": threshold " << threshold << " de p-valor " << pvalue << " fora do limite\n";
+          ++failures;
+        }
+      }
+  
+      /**
+       * P-values of the enumerated scores in the upper tail
+       */
+      for (const auto &window : windows) {
+        if (window.p > 1e-1) break;
+        const double exact = exactTail(windows, window.score);
+        if (exact < 1e-5) continue;
+        const double pvalue = scorePvalue(dist, window.score);
+        const bool inside = exactTail(windows, window.score + h) <= pvalue * (1 + CHECK_SLACK) && pvalue <= exactTail(windows, window.score - h) * (1 + CHECK_SLACK);
+        if (!inside) {
+          std::cerr << model.first << " tau " << tau << ": p-valor " << pvalue << " do score " << window.score << " fora do limite\n";
+          ++failures;
+          break;
+        }
+      }
+      if (h > CHECK_MARGIN) ++failures;
+  
+      char line[128];
+      std::snprintf(line, sizeof(line), "%s\t%d\t%d\t%.4f\t%.4f\n", model.first.c_str(), tau, k, dist.eps, h);
+      std::cout << line;
+    }
+  }
+  
+  return failures > 0 ? 1 : 0;
+}
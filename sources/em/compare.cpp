@@ -0,0 +1,353 @@
+#include "compare.h"
+#include "prob_utils.h"
+#include <immintrin.h>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cctype>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+//'Similarity of one query column with n store columns, x = qf . features + bias.
+//'@name columnScoresScalar
+//'@param qf Features of the query column.
+//'@param nf Number of features.
+//'@param features First column of the store features, feature f at features[f * stride].
+//'@param stride Columns of the whole store.
+//'@param bias Bias of the first column.
+//'@param n Number of columns.
+//'@param out Receives the n scores.
+void columnScoresScalar(const double *qf, const int nf, const double *features, const size_t stride, const double *bias, const size_t n, double *out) {
+  for (size_t j = 0; j < n; ++j) {
+    double x = bias[j];
+    for (int f = 0; f < nf; ++f) x += qf[f] * features[f * stride + j];
+    out[j] = x;
+  }
+}
+
+//'Column similarities with AVX2, 4 store columns per step, one FMA per feature.
+//'@name columnScoresAVX2
+//'@param qf Features of the query column.
+//'@param nf Number of features.
+//'@param features First column of the store features, feature f at features[f * stride].
+//'@param stride Columns of the whole store.
+//'@param bias Bias of the first column.
+//'@param n Number of columns.
+//'@param out Receives the n scores.
+__attribute__((target("avx2,fma")))
+void columnScoresAVX2(const double *qf, const int nf, const double *features, const size_t stride, const double *bias, const size_t n, double *out) {
+  size_t j = 0;
+  for (; j + 4 <= n; j += 4) {
+    __m256d acc = _mm256_loadu_pd(bias + j);
+    for (int f = 0; f < nf; ++f) acc = _mm256_fmadd_pd(_mm256_set1_pd(qf[f]), _mm256_loadu_pd(features + f * stride + j), acc);
+    _mm256_storeu_pd(out + j, acc);
+  }
+  columnScoresScalar(qf, nf, features + j, stride, bias + j, n - j, out + j);
+}
+
+//'Widest column kernel supported by the CPU, resolved once.
+//'@name columnKernel
+//'@return Pointer to the kernel.
+ColumnKernel columnKernel() {
+  static const ColumnKernel kernel = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? columnScoresAVX2 : columnScoresScalar;
+  return kernel;
+}
+
+//'Metric of a name.
+//'@name compareMetric
+//'@param name pcc (Pearson correlation), ed (Euclidean distance) or kl (symmetric Kullback-Leibler).
+//'@return COMPARE_PCC, COMPARE_ED, COMPARE_KL or -1.
+int compareMetric(const std::string &name) {
+  if (name == "pcc") return COMPARE_PCC;
+  if (name == "ed") return COMPARE_ED;
+  if (name == "kl") return COMPARE_KL;
+  return -1;
+}
+
+//'Read a motif database in JASPAR format, a header >ID NAME and the rows A, C, G and T
+//'of counts, with or without the letters and brackets. Columns of counts get a pseudocount,
+//'columns of frequencies are floored.
+//'@name readJaspar
+//'@param path JASPAR file, one or many motifs.
+//'@param store Receives the motifs.
+//'@return false if the file is missing or some motif has not 4 rows of the same size.
+bool readJaspar(const std::string &path, MotifStore &store) {
+  std::ifstream file(path);
+  if (!file) return false;
+  
+  store = MotifStore();
+  store.offsets.push_back(0);
+  std::vector<double> columns;
+  std::vector<std::vector<double>> rows;
+  
+  auto flush = [&]() {
+    if (rows.empty()) return true;
+    const size_t k = rows[0].size();
+    if (rows.size() != 4 || k == 0) return false;
+    for (const auto &row : rows) if (row.size() != k) return false;
+  
+    for (size_t l = 0; l < k; ++l) {
+      const double total = rows[0][l] + rows[1][l] + rows[2][l] + rows[3][l];
+      for (int c = 0; c < 4; ++c) {
+        double p = total > 1.5 ? (rows[c][l] + COMPARE_PSEUDOCOUNT / 4) / (total + COMPARE_PSEUDOCOUNT) : std::max(rows[c][l] / total, COMPARE_FLOOR);
+        columns.push_back(p);
+      }
+    }
+    store.offsets.push_back(store.offsets.back() + k);
+    rows.clear();
+    return true;
+  };
+  
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line.find_first_not_of(" \t\r") == std::string::npos) continue;
+  
+    if (line[0] == '>') {
+      if (!flush()) return false;
+      std::istringstream header(line.substr(1));
+      std::string id, name;
+      header >> id;
+      std::getline(header >> std::ws, name);
+      if (!name.empty() && name.back() == '\r') name.pop_back();
+      store.ids.push_back(id);
+      store.names.push_back(name);
+      continue;
+    }
+  
+    std::replace(line.begin(), line.end(), '[', ' ');
+    std::replace(line.begin(), line.end(), ']', ' ');
+    std::istringstream values(line);
+    std::vector<double> row;
+    std::string token;
+    while (values >> token) {
+      if (std::isalpha(static_cast<unsigned char>(token[0]))) continue;
+      row.push_back(std::stod(token));
+    }
+    rows.push_back(row);
+  }
+  if (!flush() || store.ids.size() + 1 != store.offsets.size()) return false;
+  
+  store.columns = arma::mat(columns.data(), 4, columns.size() / 4);
+  return true;
+}
+
+//'Null database, copies of every motif with the columns shuffled. Composition and size of
+//'the motifs are kept, only the order that makes them a motif is lost.
+//'@name shuffleStore
+//'@param store Motif database.
+//'@param copies Shuffled copies of each motif.
+//'@param seed Seed of the shuffles.
+//'@return Store of copies x motifs, the ids of the copies are the ids of the motifs.
+MotifStore shuffleStore(const MotifStore &store, const int copies, const unsigned seed) {
+  std::mt19937 gen(seed);
+  MotifStore null;
+  null.offsets.push_back(0);
+  null.columns.set_size(4, store.columns.n_cols * copies);
+  
+  size_t col = 0;
+  for (int copy = 0; copy < copies; ++copy) {
+    for (size_t t = 0; t + 1 < store.offsets.size(); ++t) {
+      std::vector<size_t> order(store.offsets[t + 1] - store.offsets[t]);
+      std::iota(order.begin(), order.end(), store.offsets[t]);
+      std::shuffle(order.begin(), order.end(), gen);
+      for (const size_t l : order) {
+        for (int c = 0; c < 4; ++c) null.columns(c, col) = store.columns(c, l);
+        ++col;
+      }
+      null.ids.push_back(store.ids[t]);
+      null.names.push_back(store.names[t]);
+      null.offsets.push_back(col);
+    }
+  }
+  
+  return null;
+}
+
+//'Features of the store columns for a metric, computed once per database.
+//'pcc: centered and normalized column. ed: -2 d, bias |d|^2. kl: -log(d) / 2 and -d / 2,
+//'bias sum(d log d) / 2.
+//'@name columnFeatures
+//'@param columns Probabilities, 4 x n.
+//'@param metric COMPARE_PCC, COMPARE_ED or COMPARE_KL.
+//'@return Features of the columns.
+ColumnFeatures columnFeatures(const arma::mat &columns, const int metric) {
+  ColumnFeatures features;
+  features.metric = metric;
+  features.nf = metric == COMPARE_KL ? 8 : 4;
+  features.n = columns.n_cols;
+  features.data.assign(features.nf * features.n, 0.0);
+  features.bias.assign(features.n, 0.0);
+  
+  const size_t n = features.n;
+  for (size_t j = 0; j < n; ++j) {
+    double norm = 0.0;
+    for (int c = 0; c < 4; ++c) norm += (columns(c, j) - .25) * (columns(c, j) - .25);
+    norm = std::sqrt(norm);
+  
+    for (int c = 0; c < 4; ++c) {
+      const double d = columns(c, j);
+      if (metric == COMPARE_PCC) {
+        features.data[c * n + j] = norm > 0 ? (d - .25) / norm : 0.0;
+      }
+      else if (metric == COMPARE_ED) {
+        features.data[c * n + j] = -2 * d;
+        features.bias[j] += d * d;
+      }
+      else {
+        const double logd = std::log(std::max(d, COMPARE_FLOOR));
+        features.data[c * n + j] = -.5 * logd;
+        features.data[(c + 4) * n + j] = -.5 * d;
+        features.bias[j] += .5 * d * logd;
+      }
+    }
+  }
+  
+  return features;
+}
+
+// Query features of each column, its bias and the similarity of the column with a uniform one
+static void queryFeatures(const arma::mat &alpha, const int metric, std::vector<double> &qf, std::vector<double> &qb, std::vector<double> &base) {
+  const int k = alpha.n_cols;
+  qf.assign(k * COMPARE_FEATURES, 0.0);
+  qb.assign(k, 0.0);
+  base.assign(k, 0.0);
+  
+  for (int l = 0; l < k; ++l) {
+    double q[4], total = 0.0, norm = 0.0;
+    for (int c = 0; c < 4; ++c) total += q[c] = std::max(alpha(c, l), COMPARE_FLOOR);
+    for (int c = 0; c < 4; ++c) {
+      q[c] /= total;
+      norm += (q[c] - .25) * (q[c] - .25);
+    }
+    norm = std::sqrt(norm);
+  
+    double *f = qf.data() + l * COMPARE_FEATURES;
+    for (int c = 0; c < 4; ++c) {
+      if (metric == COMPARE_PCC) {
+        f[c] = norm > 0 ? (q[c] - .25) / norm : 0.0;
+      }
+      else if (metric == COMPARE_ED) {
+        f[c] = q[c];
+        qb[l] += q[c] * q[c];
+      }
+      else {
+        f[c] = q[c];
+        f[c + 4] = std::log(q[c]);
+        qb[l] += .5 * q[c] * std::log(q[c]);
+        base[l] += .5 * (q[c] - .25) * std::log(q[c] / .25);
+      }
+    }
+    if (metric == COMPARE_ED) base[l] = norm;
+  }
+}
+
+// Best alignment of the query, both strands, with every motif of a store
+static std::vector<MotifMatch> alignStore(const std::vector<double> qf[2], const std::vector<double> qb[2], const std::vector<double> base[2], const int k, const MotifStore &store, const ColumnFeatures &features) {
+  const size_t nmotifs = store.offsets.size() - 1;
+  const ColumnKernel kernel = columnKernel();
+  std::vector<MotifMatch> best(nmotifs);
+  
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, nmotifs, COMPARE_BLOCK), [&](const tbb::blocked_range<size_t> &range) {
+    const size_t c0 = store.offsets[range.begin()];
+    const size_t n = store.offsets[range.end()] - c0;
+    std::vector<double> s(k * n);
+  
+    for (size_t t = range.begin(); t < range.end(); ++t) best[t] = {int(t), 0, '+', 0, -std::numeric_limits<double>::infinity(), 1.0, 0.0};
+  
+    for (int strand = 0; strand < 2; ++strand) {
+  
+      /**
+       * Similarity of each query column with every column of the block
+       */
+      for (int i = 0; i < k; ++i) {
+        double *row = s.data() + i * n;
+        kernel(qf[strand].data() + i * COMPARE_FEATURES, features.nf, features.data.data() + c0, features.n, features.bias.data() + c0, n, row);
+        const double b = base[strand][i], q = qb[strand][i];
+        if (features.metric == COMPARE_ED) for (size_t j = 0; j < n; ++j) row[j] = b - std::sqrt(std::max(row[j] + q, 0.0));
+        if (features.metric == COMPARE_KL) for (size_t j = 0; j < n; ++j) row[j] = b - row[j] - q;
+      }
+  
+      /**
+       * Sums over the diagonals, every offset with enough aligned columns
+       */
+      for (size_t t = range.begin(); t < range.end(); ++t) {
+        const int start = store.offsets[t] - c0;
+        const int kd = store.offsets[t + 1] - store.offsets[t];
+        const int overlap = std::min({COMPARE_MIN_OVERLAP, k, kd});
+        for (int o = overlap - k; o <= kd - overlap; ++o) {
+          const int i0 = std::max(0, -o), i1 = std::min(k, kd - o);
+          double score = 0.0;
+          for (int i = i0; i < i1; ++i) score += s[i * n + start + i + o];
+          if (score > best[t].score) best[t] = {int(t), o, strand ? '-' : '+', i1 - i0, score, 1.0, 0.0};
+        }
+      }
+    }
+  });
+  
+  return best;
+}
+
+//'Compare a model with every motif of a database, both strands and all offsets. The
+//'p-value of a match comes from a Gumbel fitted to the best scores of the model against
+//'shuffled motifs of about the same size.
+//'@name compareModel
+//'@param alpha PWM model, 4 x k.
+//'@param db Motif database.
+//'@param features Features of the database columns.
+//'@param null Shuffled database of shuffleStore.
+//'@param null_features Features of the null columns, same metric.
+//'@return Best match with each database motif, by p-value.
+std::vector<MotifMatch> compareModel(const arma::mat &alpha, const MotifStore &db, const ColumnFeatures &features, const MotifStore &null, const ColumnFeatures &null_features) {
+  const int k = alpha.n_cols;
+  std::vector<double> qf[2], qb[2], base[2];
+  queryFeatures(alpha, features.metric, qf[0], qb[0], base[0]);
+  queryFeatures(alpha2rc(alpha), features.metric, qf[1], qb[1], base[1]);
+  
+  std::vector<MotifMatch> matches = alignStore(qf, qb, base, k, db, features);
+  const std::vector<MotifMatch> nulls = alignStore(qf, qb, base, k, null, null_features);
+  
+  /**
+   * Null scores by motif size, pooled with the nearest sizes up to COMPARE_MIN_NULL
+   */
+  std::vector<std::vector<double>> by_size;
+  for (size_t t = 0; t < nulls.size(); ++t) {
+    const size_t kd = null.offsets[t + 1] - null.offsets[t];
+    if (by_size.size() <= kd) by_size.resize(kd + 1);
+    by_size[kd].push_back(nulls[t].score);
+  }
+  
+  // Best scores over all offsets are maxima, a Gumbel fitted by moments gives the tail
+  std::vector<double> loc(by_size.size(), 0.0), scale(by_size.size(), 0.0);
+  for (size_t kd = 0; kd < by_size.size(); ++kd) {
+    if (by_size[kd].empty()) continue;
+    std::vector<double> scores;
+    for (size_t d = 0; scores.size() < COMPARE_MIN_NULL && (d <= kd || kd + d < by_size.size()); ++d) {
+      if (d <= kd) scores.insert(scores.end(), by_size[kd - d].begin(), by_size[kd - d].end());
+      if (d > 0 && kd + d < by_size.size()) scores.insert(scores.end(), by_size[kd + d].begin(), by_size[kd + d].end());
+    }
+    
+    double mean = 0.0, var = 0.0;
+    for (const double x : scores) mean += x;
+    mean /= scores.size();
+    for (const double x : scores) var += (x - mean) * (x - mean);
+    var /= std::max<size_t>(scores.size() - 1, 1);
+    
+    scale[kd] = std::max(std::sqrt(var * 6.0) / M_PI, 1e-12);
+    loc[kd] = mean - EULER_GAMMA * scale[kd];
+  }
+  
+  for (auto &match : matches) {
+    const size_t kd = std::min<size_t>(db.offsets[match.target + 1] - db.offsets[match.target], by_size.size() - 1);
+    match.pvalue = -std::expm1(-std::exp(-(match.score - loc[kd]) / scale[kd]));
+    match.evalue = match.pvalue * matches.size();
+  }
+  
+  std::sort(matches.begin(), matches.end(), [](const MotifMatch &a, const MotifMatch &b) {
+    return a.pvalue != b.pvalue ? a.pvalue < b.pvalue : a.score > b.score;
+  });
+  
+  return matches;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <string>
+
+#define COMPARE_PCC 0
+#define COMPARE_ED 1
+#define COMPARE_KL 2
+#define COMPARE_FEATURES 8          // Max features of a column, kl uses all of them
+#define COMPARE_PSEUDOCOUNT 1.0     // Pseudocount of the database counts, shared by the 4 bases
+#define COMPARE_FLOOR 1e-4          // Min probability of a query column, for kl
+#define COMPARE_MIN_OVERLAP 5       // Min aligned columns, or the size of the smaller motif
+#define COMPARE_NULL_COPIES 10      // Column shuffled copies of each database motif in the null
+#define COMPARE_MIN_NULL 1000       // Min null scores behind a p-value, pooled over nearby lengths
+#define COMPARE_SEED 42
+#define COMPARE_BLOCK 64            // Database motifs per parallel task
+#ifndef EULER_GAMMA
+#define EULER_GAMMA 0.57722
+#endif
+
+// Motif database in one contiguous column major store, motif i owns the columns
+// offsets[i] to offsets[i + 1] - 1.
+struct MotifStore {
+  std::vector<std::string> ids;
+  std::vector<std::string> names;
+  std::vector<size_t> offsets;
+  arma::mat columns;               // Probabilities, 4 x total columns
+};
+
+// Columns of a store mapped so that every metric is a dot product plus a bias,
+// x = q . d + bias(d). Features are stored feature major, nf rows of n values, so the
+// kernel streams each feature over consecutive columns.
+struct ColumnFeatures {
+  int metric = COMPARE_PCC;
+  int nf = 0;
+  size_t n = 0;
+  std::vector<double> data;
+  std::vector<double> bias;
+};
+
+// Best alignment of a query model with a database motif.
+struct MotifMatch {
+  int target;        // Index of the motif in the database
+  int offset;        // Position of the first query column in the motif, may be negative
+  char strand;       // + or -, the query reverse complement
+  int overlap;       // Aligned columns
+  double score;      // Sum of the column similarities over the overlap
+  double pvalue;     // Gumbel tail of the null scores
+  double evalue;     // pvalue x database size
+};
+
+typedef void (*ColumnKernel)(const double *qf, const int nf, const double *features, const size_t stride, const double *bias, const size_t n, double *out);
+
+void columnScoresScalar(const double *qf, const int nf, const double *features, const size_t stride, const double *bias, const size_t n, double *out);
+void columnScoresAVX2(const double *qf, const int nf, const double *features, const size_t stride, const double *bias, const size_t n, double *out);
+ColumnKernel columnKernel();
+
+int compareMetric(const std::string &name);
+bool readJaspar(const std::string &path, MotifStore &store);
+MotifStore shuffleStore(const MotifStore &store, const int copies, const unsigned seed);
+ColumnFeatures columnFeatures(const arma::mat &columns, const int metric);
+std::vector<MotifMatch> compareModel(const arma::mat &alpha, const MotifStore &db, const ColumnFeatures &features, const MotifStore &null, const ColumnFeatures &null_features);
@@ -1,5 +1,11 @@
 #include "oops.h"
 #include "zoops.h"
+#include "batch_em.h"
+#include "fast_em.h"
+#include "squarem.h"
+#include "screen.h"
+#include "summary.h"
+#include "hmap_io.h"
 #include "utils.h"
 #include "prob_utils.h"
 #include <iostream>
@@ -16,7 +22,7 @@ int main(int argc, char *argv[]) {
   
   // Verificar se há número suficiente de argumentos
   if (argc < 13) {
-    std::cerr << "Use: em -i <fasta> options\n   -type <oops, zoops or anr>\n   -k <size of kmer> \n   -niter <number of em iterations>\n   -cutoff <small number for convergence controll> \n   -n <number of models>\n";
+    std::cerr << "Use: em -i <fasta> options\n   -type <oops, zoops or anr>\n   -k <size of kmer> \n   -niter <number of em iterations>\n   -cutoff <small number for convergence controll> \n   -n <number of models>\n   -fast <kdive or hmap, FAST-EM over kmer counts>\n   -polish <positional em iterations after FAST-EM>\n   -overlap <0 or 1, anr overlapping sites correction>\n   -squarem <0 or 1, SQUAREM acceleration of oops and zoops>\n   -tau <order of the background Markov chain, up to 5>\n   -bg <background cache file, reused across runs>\n   -screen <number of distinct seeds forwarded to EM, 0 for all>\n   -strands <1 or 2, score the reverse strand too, oops and zoops>\n   -palindrome <0 or 1, keep the models equal to their reverse complement>\n   -tile <max size of the tiles of long records, 0 to keep whole records, all tiles are kept in memory>\n   -summary <0 or 1, summary.txt and svg logos of the models>\n";
     return 1;
   }
   
@@ -26,6 +32,17 @@ int main(int argc, char *argv[]) {
   double cutoff = 0.0;
   int k = 0;
   int nmodels = 0;
+  std::string fast = "";
+  int polish = 0;
+  bool overlap = false;
+  bool accelerate = false;
+  int tau = 0;
+  std::string cache = "";
+  int screen = 0;
+  int strands = 1;
+  bool palindrome = false;
+  size_t tile = 0;
+  bool summary = false;
   
   for (int i = 1; i < argc; i += 2) {
     std::string arg = argv[i];
@@ -54,46 +71,165 @@ int main(int argc, char *argv[]) {
       nmodels = std::stoi(argv[i + 1]);
     }
     
+    else if (arg == "-fast") {
+      fast = argv[i + 1];
+    }
+    
+    else if (arg == "-polish") {
+      polish = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-overlap") {
+      overlap = std::stoi(argv[i + 1]) != 0;
+    }
+    
+    else if (arg == "-squarem") {
+      accelerate = std::stoi(argv[i + 1]) != 0;
+    }
+    
+    else if (arg == "-tau") {
+      tau = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-bg") {
+      cache = argv[i + 1];
+    }
+    
+    else if (arg == "-screen") {
+      screen = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-strands") {
+      strands = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-palindrome") {
+      palindrome = std::stoi(argv[i + 1]) != 0;
+    }
+    
+    else if (arg == "-tile") {
+      tile = std::stoul(argv[i + 1]);
+    }
+    
+    else if (arg == "-summary") {
+      summary = std::stoi(argv[i + 1]) != 0;
+    }
+    
     else {
       std::cerr << "Argumento desconhecido: " << arg << "\n";
       return 1;
     }
   }
   
+  if (tau < 0 || tau > MAX_TAU) {
+    std::cerr << "Ordem do background precisa estar entre 0 e " << MAX_TAU << "\n";
+    return 1;
+  }
+  
+  // FAST-EM is checked before smt_data/models is wiped, a bad option keeps the last models
+  if (!fast.empty() && fast != "kdive" && fast != "hmap") {
+    std::cerr << "FAST-EM inválido: precisa ser kdive ou hmap\n";
+    return 1;
+  }
+  HmapView hmap;
+  if (fast == "hmap" && (!openHmap(hmap, "smt_data/hmap.bin") || hmap.k != k)) {
+    std::cerr << "smt_data/hmap.bin precisa existir com kmers de tamanho " << k << "\n";
+    return 1;
+  }
+  
+  // Both strands are scored in the same pass over each window
+  const int strand_mode = palindrome ? STRAND_PALINDROME : strands == 2 ? STRAND_BOTH : STRAND_FORWARD;
+  
   // Build siblings models
-  std::vector<arma::mat> models = *build_models_from_sibligs(k);
+  std::vector<KmerTable> sibligs = read_sibligs();
+  std::vector<arma::mat> models;
+  for (const auto &table : sibligs) models.push_back(sibligs2alpha(table, k));
   
   // Run EM
-  const auto fasta = readFasta(path);
-  arma::mat beta = createMarkovChain(fasta, 0);
+  // Long records in tiles overlapping by k-1, the background is counted once per symbol
+  std::vector<TileCoord> coords;
+  const auto fasta = tile > 0 ? readFastaTiles(path, tile, k - 1, coords) : readFasta(path);
+  const auto data = encodeFasta(fasta);
+  arma::mat beta = !cache.empty() ? cachedMarkovChain(cache, path, tau) : tile > 0 ? streamMarkovChain(path, tau, BG_BATCH) : createMarkovChain(fasta, tau);
   arma::mat new_alpha;
   int ret =  std::system("rm -Rf smt_data/models");
   ret = std::system("mkdir -p smt_data/models");
   
-  if (type == "oops") {
-    tbb::blocked_range<size_t> r(0, models.size());
-    tbb::parallel_for(r, [&](const auto &r) {
-      for (size_t i = r.begin(); i != r.end(); ++i) {
-        const auto &alpha = models[i];
-        arma::mat new_alpha = oops(fasta, alpha, beta, cutoff, niter, 1.0);  // Ajuste os argumentos conforme necessário
-        new_alpha.save("smt_data/models/m" + std::to_string(i + 1), arma::csv_ascii);
-      }
-    });
+  // Screening, only the best distinct seeds go to EM
+  if (screen > 0 && !models.empty()) {
+    arma::cube seeds(4, k, models.size());
+    for (size_t i = 0; i < models.size(); ++i) seeds.slice(i) = models[i];
+    std::vector<SeedScore> scores;
+    const std::vector<int> kept = screen_seeds(data, seeds, beta, type == "oops" ? 1.0 : .5, type != "oops", screen, scores);
+    saveScreen(scores, "smt_data/screen.txt");
+    
+    std::vector<arma::mat> kept_models;
+    std::vector<KmerTable> kept_sibligs;
+    for (const int i : kept) {
+      kept_models.push_back(models[i]);
+      kept_sibligs.push_back(sibligs[i]);
+    }
+    models.swap(kept_models);
+    sibligs.swap(kept_sibligs);
   }
   
-  else if (type == "zoops") {
-    tbb::blocked_range<size_t> r(0, models.size());
-    tbb::parallel_for(r, [&](const auto &r) {
-      for (size_t i = r.begin(); i != r.end(); ++i) {
-        const auto &alpha = models[i];
-        arma::mat new_alpha = zoops(fasta, alpha, beta, cutoff, niter, .5);
-        new_alpha.save("smt_data/models/m" + std::to_string(i+1), arma::csv_ascii);
-      }
+  // FAST-EM over distinct kmers, positional EM only polishes the result
+  if (fast == "kdive") {
+    tbb::parallel_for(size_t(0), models.size(), [&](size_t i) {
+      const auto &table = sibligs[i];
+      models[i] = fast_em(table.codes.data(), table.counts.data(), table.codes.size(), models[i], beta, cutoff, niter, .5);
     });
+    niter = polish;
+  }
+  
+  else if (fast == "hmap") {
+    for (auto &alpha : models) alpha = fast_em(hmap.codes, hmap.counts, hmap.n, alpha, beta, cutoff, niter, .5);
+    niter = polish;
+  }
+  
+  std::vector<arma::mat> fitted;
+  if (!fast.empty() && niter == 0) {
+    fitted = models;
+    for (size_t i = 0; i < models.size(); ++i) {
+      models[i].save("smt_data/models/m" + std::to_string(i + 1), arma::csv_ascii);
+    }
+  }
+  
+  else if (accelerate && (type == "oops" || type == "zoops")) {
+    
+    // SQUAREM refines one model at a time, each cycle extrapolates over three EM maps
+    ret = std::system("mkdir -p smt_data/squarem");
+    for (size_t i = 0; i < models.size(); ++i) {
+      std::vector<SquaremTrace> trace;
+      new_alpha = squarem(data, models[i], beta, cutoff, niter, type == "zoops" ? .5 : 1.0, type == "zoops", strand_mode, trace);
+      new_alpha.save("smt_data/models/m" + std::to_string(i + 1), arma::csv_ascii);
+      fitted.push_back(new_alpha);
+      saveSquaremTrace(trace, "smt_data/squarem/m" + std::to_string(i + 1) + ".txt");
+    }
   }
   
-  else if (type == "anr") {
+  else if (type == "oops" || type == "zoops" || type == "anr") {
     
+    // All models are refined together, one pass over the data per iteration
+    arma::cube alphas(4, k, models.size());
+    for (size_t i = 0; i < models.size(); ++i) alphas.slice(i) = models[i];
+    
+    // ANR starts with one expected site per sequence
+    double w = 1.0;
+    if (type == "zoops") w = .5;
+    if (type == "anr") {
+      double positions = 0.0;
+      for (size_t i = 0; i < data.size(); ++i) positions += std::max(data.length(i) - k + 1, 0);
+      w = data.size() / positions;
+    }
+    
+    std::string mod = type == "oops" ? "OOPS" : type == "zoops" ? "ZOOPS" : "ANR";
+    arma::cube new_alphas = batch_em(data, alphas, beta, cutoff, niter, w, mod, overlap, strand_mode);
+    
+    for (size_t i = 0; i < models.size(); ++i) {
+      new_alphas.slice(i).save("smt_data/models/m" + std::to_string(i + 1), arma::csv_ascii);
+      fitted.push_back(new_alphas.slice(i));
+    }
   }
   
   else {
@@ -101,6 +237,13 @@ int main(int argc, char *argv[]) {
     return 1;
   }
   
+  // Significance and logos straight from the fitted models, as the summary tool
+  if (summary) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < fitted.size(); ++i) names.push_back("m" + std::to_string(i + 1));
+    saveSummary(names, fitted, "smt_data/summary.txt");
+    for (size_t i = 0; i < fitted.size(); ++i) saveLogo(fitted[i], "smt_data/models/" + names[i] + ".svg");
+  }
   
   return 0;
 }
\ No newline at end of file
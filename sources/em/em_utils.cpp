@@ -8,25 +8,52 @@
 std::unique_ptr<std::vector<arma::mat>> build_models_from_sibligs(const int k) {
   auto models_ptr = std::make_unique<std::vector<arma::mat>>();
   std::vector<arma::mat> &models = *models_ptr;
+  for (const auto &table : read_sibligs()) {
+    models.push_back(sibligs2alpha(table, k));
+  }
+  
+  return models_ptr;
+}
+
+//'Create a PWM model from the sibligs kmers of a seed.
+//'@name sibligs2alpha.
+//'@param table Sibligs kmers and counts.
+//'@param k Kmer size.
+//'@return PWM model.
+arma::mat sibligs2alpha(const KmerTable &table, const int k) {
+  arma::mat model(4, k);
+  model.fill(1.00);
+  double total = 0.0;
+  for (size_t j = 0; j < table.codes.size(); ++j) {
+    for (int i = 0; i < k; ++i) {
+      int line = (table.codes[j] >> (2 * (k - 1 - i))) & 3;
+      model(line, i) += table.counts[j];
+    }
+    total += table.counts[j];
+  }
+  
+  return model / (total + 4);
+}
+
+//'Read sibligs kmers and counts of each seed in smt_data/kdive_dir.
+//'@name read_sibligs.
+//'@return One table for each file, in the same order of build_models_from_sibligs.
+std::vector<KmerTable> read_sibligs() {
+  std::vector<KmerTable> tables;
   for(const auto &entry : fs::directory_iterator("smt_data/kdive_dir")) {
     std::ifstream file(entry.path());
-    std::string line;
-    arma::mat model(4, k);
-    model.fill(1.00);
+    KmerTable table;
     std::string kmer;
-    int count = 0;
-    double total = 0.0;
+    uint64_t count = 0;
     while(file >> kmer >> count) {
-      int i = 0;
-      for (const auto &c : kmer) {
-        int line = char2int(c);
-        model(line, i++) += count;
-        total += count;
-      }
+      uint64_t code = 0;
+      for (const auto &c : kmer) code = (code << 2) | char2int(c);
+      table.codes.push_back(code);
+      table.counts.push_back(count);
     }
     file.close();
-    models.push_back(model / (total + 4));
+    tables.push_back(std::move(table));
   }
   
-  return models_ptr;
+  return tables;
 }
\ No newline at end of file
@@ -7,6 +7,16 @@
 #include <fstream>
 #include <iostream>
 #include <cstdlib>
+#include <cstdint>
+#include <algorithm>
 namespace fs = std::filesystem;
 
-std::unique_ptr<std::vector<arma::mat>> build_models_from_sibligs(const int k);
\ No newline at end of file
+// Distinct kmers (2 bits per symbol) and their counts, weighted observations of fast_em.
+struct KmerTable {
+  std::vector<uint64_t> codes;
+  std::vector<uint64_t> counts;
+};
+
+std::unique_ptr<std::vector<arma::mat>> build_models_from_sibligs(const int k);
+std::vector<KmerTable> read_sibligs();
+arma::mat sibligs2alpha(const KmerTable &table, const int k);
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "fast_em.h"
+#include "prob_utils.h"
+
+//'Runs FAST-EM over distinct kmers weighted by their counts and reestimates the model.
+//'Each kmer is a motif site with probability w or background otherwise, so the cost
+//'depends on the number of distinct kmers and not on the size of the dataset.
+//'@name fast_em
+//'@param codes Kmer indexes, 2 bits per symbol, first symbol in the high bits.
+//'@param counts Count of each kmer.
+//'@param n Number of kmers.
+//'@param alpha PWM model to be reestimated, with the same size of the kmers.
+//'@param beta Markov Chain of any order.
+//'@param cutoff Cutoff for EM convergence.
+//'@param niter Maximum number of iterations.
+//'@param w Priori probability of a kmer be a motif site.
+//'@return Updated PWM model.
+arma::mat fast_em(const uint64_t *codes, const uint64_t *counts, const size_t n, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w) {
+  /**
+   * Parameters
+   */
+  const int k = alpha.n_cols;
+  double total = 0.0;
+  for (size_t i = 0; i < n; ++i) total += counts[i];
+  
+  /**
+   * Background log-probability of each kmer, fixed during EM
+   */
+  const std::vector<arma::mat> tables = backgroundTables(beta);
+  std::vector<double> bglog(n);
+  tbb::parallel_for(size_t(0), n, [&](size_t i) { bglog[i] = backgroundLog(codes[i], k, tables); });
+  
+  /**
+   * Model to reestimate
+   */
+  arma::mat alphalog(4, k);
+  
+  /**
+   * Accumulators of each chunk of kmers, folded in order
+   */
+  const size_t nchunks = (n + FAST_CHUNK - 1) / FAST_CHUNK;
+  std::vector<arma::mat> chunk_counts(nchunks, arma::mat(4, k));
+  std::vector<double> chunk_w(nchunks);
+  
+  /**
+   * Convergence control
+   */
+  std::vector<double> convergence;
+  std::vector<double> changes;
+  convergence.reserve(niter + 2);
+  changes.reserve(niter + 2);
+  convergence.push_back(-std::numeric_limits<double>::infinity());
+  changes.push_back(0);
+  
+  while (n > 0) {
+    alphalog = arma::log(alpha);
+    const double *a = alphalog.memptr();
+    const double prior = std::log1p(-w) - std::log(w);
+    
+    /**
+     * E-STEP and M-STEP counts, parallel across kmers
+     */
+    tbb::parallel_for(size_t(0), nchunks, [&](size_t c) {
+      double *acc = chunk_counts[c].zeros().memptr();
+      double sumw = 0.0;
+      
+      for (size_t i = c * FAST_CHUNK; i < std::min(n, (c + 1) * FAST_CHUNK); ++i) {
+        const uint64_t code = codes[i];
+        double lo = -bglog[i];
+        for (int l = 0; l < k; ++l) lo += a[4 * l + ((code >> (2 * (k - 1 - l))) & 3)];
+        
+        // Responsibility as a logistic of the log-odds, exp(lo) alone overflows for long kmers
+        const double r = counts[i] / (1 + std::exp(prior - lo));
+        sumw += r;
+        for (int l = 0; l < k; ++l) acc[4 * l + ((code >> (2 * (k - 1 - l))) & 3)] += r;
+      }
+      
+      chunk_w[c] = sumw;
+    });
+    
+    /**
+     * M-STEP
+     */
+    alpha.fill(1e-100);
+    double new_w = 0.0;
+    for (size_t c = 0; c < nchunks; ++c) {
+      alpha += chunk_counts[c];
+      new_w += chunk_w[c];
+    }
+    alpha /= arma::accu(alpha.col(0));
+    w = std::min(new_w / total, 1.0 - 1e-12);
+    
+    /**
+     * Convergence control
+     */
+    if (hasConverged(cutoff, niter, alpha, convergence, changes)) break;
+    
+    /**
+     * Next iteration
+     */
+    --niter;
+  }
+  
+  return alpha;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <cstdint>
+#include <tbb/parallel_for.h>
+#include <tbb/tbb.h>
+
+#define FAST_CHUNK 4096
+
+arma::mat fast_em(const uint64_t *codes, const uint64_t *counts, const size_t n, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w);
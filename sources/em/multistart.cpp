@@ -0,0 +1,111 @@
+#include "multistart.h"
+#include "prob_utils.h"
+#include "oops.h"
+#include "zoops.h"
+
+//'Random starting model from one kmer of the dataset.
+//'@name kmer2start
+//'@param fasta Dataset of sequences, at least one of size k.
+//'@param k Size of kmer.
+//'@param gen Random generator of the restart.
+//'@return PWM model of the kmer with the pseudocounts of kmers2alpha.
+static arma::mat kmer2start(const std::vector<std::string> &fasta, const int k, std::mt19937 &gen) {
+  if (fasta.empty()) throw std::invalid_argument("Nenhuma sequência para criar o modelo inicial");
+  std::uniform_int_distribution<size_t> pick(0, fasta.size() - 1);
+  for (int tries = 0; tries < 100; ++tries) {
+    const std::string &seq = fasta[pick(gen)];
+    if (int(seq.size()) < k) continue;
+    std::uniform_int_distribution<> pos(0, seq.size() - k);
+    return kmers2alpha({seq.substr(pos(gen), k)});
+  }
+  
+  return fasta2alpha(fasta, k, gen);
+}
+
+// Buffers of the EM iterations of one parallel slot, created once and reused by every
+// restart that runs in the slot.
+struct RestartBuffers {
+  EMWorkspace ws;
+  arma::mat alphalog;
+  arma::mat new_alpha;
+};
+
+//'Runs EM iterations of one restart.
+//'@name advance
+//'@param data Encoded dataset of sequences.
+//'@param bg Background prefixes of the dataset.
+//'@param start Restart to advance, alpha, w and ll are updated.
+//'@param zoops ZOOPS if true, OOPS otherwise.
+//'@param iterations Number of EM iterations.
+//'@param buffers Workspace and models of the slot, sized for the restart.
+static void advance(const EncodedFasta &data, const Background &bg, Restart &start, const bool zoops, const int iterations, RestartBuffers &buffers) {
+  for (int i = 0; i < iterations; ++i) {
+    buffers.new_alpha.fill(1e-100);
+    double new_w = 0.0;
+    logModel(start.alpha, buffers.alphalog);
+    start.ll = estep(data, bg, buffers.alphalog, start.w, zoops, false, buffers.ws, buffers.new_alpha, new_w);
+    normalizeModel(buffers.new_alpha, start.alpha);
+    if (zoops) start.w = new_w / buffers.ws.order.size();
+  }
+}
+
+//'Runs OOPS or ZOOPS from many seeded restarts with successive halving. All restarts run
+//'a rung of EM iterations in parallel, the half with lower log-likelihood is cut, and so
+//'is every restart trailing the best one by more than MULTISTART_MARGIN per sequence. The
+//'survivors run a rung twice as long, until one restart is left. If niter is too small for
+//'a rung, one E-step scores the restarts instead. Only the best one runs to convergence.
+//'Restart r is seeded with seed + r, so runs are reproducible.
+//'@name multistart
+//'@param fasta Dataset of sequences, at least one of size k.
+//'@param data Encoded dataset.
+//'@param k Size of the models.
+//'@param beta Markov model thats represents the control senquences.
+//'@param cutoff Cutoff for EM convergence.
+//'@param niter Maximum number of iterations of the best restart.
+//'@param w Initial priori probability, 1 for OOPS.
+//'@param zoops ZOOPS if true, OOPS otherwise.
+//'@param strands STRAND_FORWARD, STRAND_BOTH or STRAND_PALINDROME.
+//'@param restarts Number of restarts.
+//'@param seed Seed of the first restart.
+//'@param survivors Restarts of each rung, in the order they were cut, the best one last.
+//'@return PWM model of the best restart.
+arma::mat multistart(const std::vector<std::string> &fasta, const EncodedFasta &data, const int k, const arma::mat &beta, const double cutoff, int niter, double w, const bool zoops, const int strands, const int restarts, const unsigned seed, std::vector<Restart> &survivors) {
+  const Background bg = backgroundPrefixes(data, beta);
+  
+  std::vector<Restart> starts(std::max(restarts, 1));
+  for (size_t r = 0; r < starts.size(); ++r) {
+    std::mt19937 gen(seed + r);
+    starts[r] = {kmer2start(fasta, k, gen), w, -std::numeric_limits<double>::infinity(), unsigned(seed + r)};
+  }
+  
+  std::vector<RestartBuffers> buffers(starts.size());
+  for (auto &slot : buffers) slot = {createWorkspace(data, k, strands), arma::mat(4, k), arma::mat(4, k)};
+  
+  /**
+   * Successive halving
+   */
+  survivors.clear();
+  const double margin = MULTISTART_MARGIN * data.size();
+  int rung = std::min(MULTISTART_RUNG, std::max(niter - 1, 1));
+  while (starts.size() > 1) {
+    tbb::parallel_for(size_t(0), starts.size(), [&](size_t r) { advance(data, bg, starts[r], zoops, rung, buffers[r]); });
+    niter = std::max(niter - rung, 1);
+    
+    std::sort(starts.begin(), starts.end(), [](const Restart &a, const Restart &b) { return a.ll > b.ll; });
+    size_t keep = 1;
+    while (keep < (starts.size() + 1) / 2 && starts[keep].ll >= starts[0].ll - margin) ++keep;
+    if (niter <= 2 * rung) keep = 1;
+    for (size_t r = starts.size(); r-- > keep; ) survivors.push_back(starts[r]);
+    starts.resize(keep);
+    rung *= 2;
+  }
+  
+  /**
+   * Best restart runs to convergence
+   */
+  Restart &best = starts[0];
+  best.alpha = zoops ? ::zoops(data, best.alpha, beta, cutoff, niter, best.w, strands) : ::oops(data, best.alpha, beta, cutoff, niter, 1.0, strands);
+  survivors.push_back(best);
+  
+  return best.alpha;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <string>
+#include <random>
+#include <stdexcept>
+#include <tbb/parallel_for.h>
+#include <tbb/tbb.h>
+#include "utils.h"
+
+#define MULTISTART_RUNG 4    // EM iterations of the first rung, doubled at each rung
+#define MULTISTART_MARGIN 0.01    // Log-likelihood per sequence a restart may trail the best one and survive a rung
+
+// State of one restart during successive halving.
+struct Restart {
+  arma::mat alpha;
+  double w;
+  double ll;
+  unsigned seed;
+};
+
+arma::mat multistart(const std::vector<std::string> &fasta, const EncodedFasta &data, const int k, const arma::mat &beta, const double cutoff, int niter, double w, const bool zoops, const int strands, const int restarts, const unsigned seed, std::vector<Restart> &survivors);
@@ -0,0 +1,102 @@
+#include "online_em.h"
+#include "prob_utils.h"
+
+//'Runs online Expectation Maximization OOPS or ZOOPS (Cappé and Moulines, 2009) streaming
+//'the dataset in mini-batches. Only the sufficient statistics, expected symbol counts and
+//'expected sites per sequence, are kept in memory. After each mini-batch they move towards
+//'the statistics of the batch with step size (b + 2)^-kappa, where b counts the mini-batches,
+//'and the model is reestimated from them.
+//'@name online_em
+//'@param path Path to fasta dataset.
+//'@param alpha PWM model to be reestimated.
+//'@param beta Markov model thats represents the control senquences.
+//'@param cutoff Cutoff for EM convergence, checked after each epoch.
+//'@param niter Maximum number of epochs.
+//'@param w Initial priori probability, 1 for OOPS.
+//'@param zoops ZOOPS if true, OOPS otherwise.
+//'@param strands STRAND_FORWARD, STRAND_BOTH or STRAND_PALINDROME.
+//'@param batch Number of sequences of each mini-batch.
+//'@param kappa Decay of the step size, in (0.5, 1].
+//'@param tile Max size of the tiles of long records, 0 to read whole records.
+//'@return Updated PWM model.
+arma::mat online_em(const std::string &path, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w, const bool zoops, const int strands, const size_t batch, const double kappa, const size_t tile) {
+  /**
+   * Parameters
+   */
+  const int k = alpha.n_cols;
+  
+  /**
+   * Sufficient statistics, per sequence
+   */
+  arma::mat stats(4, k, arma::fill::zeros);
+  double stats_w = 0.0;
+  
+  /**
+   * Statistics of the mini-batch
+   */
+  arma::mat new_alpha(4, k);
+  double new_w = 0.0;
+  arma::mat alphalog(4, k);
+  
+  /**
+   * Convergence control, once per epoch
+   */
+  std::vector<double> convergence;
+  std::vector<double> changes;
+  convergence.reserve(niter + 2);
+  changes.reserve(niter + 2);
+  convergence.push_back(-std::numeric_limits<double>::infinity());
+  changes.push_back(0);
+  
+  FastaReader reader;
+  reader.tile = tile;
+  reader.overlap = k - 1;
+  std::vector<std::string> fasta;
+  size_t step = 0;
+  
+  while (true) {
+    if (!openFasta(reader, path)) throw std::invalid_argument("Arquivo fasta não encontrado: " + path);
+    
+    while (readFastaBatch(reader, batch, fasta) > 0) {
+      const EncodedFasta data = encodeFasta(fasta);
+      const Background bg = backgroundPrefixes(data, beta);
+      EMWorkspace ws = createWorkspace(data, k, strands);
+      if (ws.order.empty()) continue;
+      
+      /**
+       * E-STEP of the mini-batch
+       */
+      new_alpha.zeros();
+      new_w = 0.0;
+      alphalog = arma::log(alpha);
+      estep(data, bg, alphalog, w, zoops, false, ws, new_alpha, new_w);
+      
+      /**
+       * Stochastic approximation of the sufficient statistics
+       */
+      const double gamma = step == 0 ? 1.0 : std::pow(step + 2.0, -kappa);
+      stats = (1 - gamma) * stats + (gamma / ws.order.size()) * new_alpha;
+      stats_w = (1 - gamma) * stats_w + gamma * new_w / ws.order.size();
+      ++step;
+      
+      /**
+       * M-STEP from the sufficient statistics
+       */
+      alpha = stats + 1e-100;
+      alpha /= arma::accu(alpha.col(0));
+      if (zoops) w = stats_w;
+    }
+    
+    /**
+     * Convergence control
+     */
+    if (hasConverged(cutoff, niter, alpha, convergence, changes)) break;
+    
+    /**
+     * Next epoch
+     */
+    --niter;
+  }
+  
+  return alpha;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <string>
+#include "utils.h"
+
+#define ONLINE_KAPPA 0.6    // Default decay of the step size, in (0.5, 1]
+
+arma::mat online_em(const std::string &path, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w, const bool zoops, const int strands, const size_t batch, const double kappa, const size_t tile);
@@ -9,60 +9,53 @@
 //'@param cutoff Cutoff for EM convergence.
 //'@param niter Maximum number of iterations.
 //'@param w Priori probability for motif belongs to position w1, w2, w3, ..., wm.
+//'@param strands STRAND_FORWARD, STRAND_BOTH or STRAND_PALINDROME.
 //'@param beta Markov model thats represents the control senquences.
-arma::mat oops(const std::vector<std::string> &fasta, arma::mat alpha, const arma::mat &beta, double cutoff, int niter, double w = 1) {
+arma::mat oops(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, double cutoff, int niter, double w = 1, const int strands = STRAND_FORWARD) {
   /**
    * Parameters
    */
   int n = fasta.size();
-  int t = fasta[0].size();
   int k = alpha.n_cols;
-  int m = t - k + 1;
+  
   /**
    * Model to reestimate
    */
   arma::mat new_alpha(4, k);
-  
+  double new_w = 0.0;
   
   /**
-   * Posteriori
+   * Background log-probabilities, fixed during EM
    */
-  arma::vec z(m);
+  const Background bg = backgroundPrefixes(fasta, beta);
+  arma::mat alphalog(4, k);
   
+  /**
+   * Accumulators of each chunk of sequences
+   */
+  EMWorkspace ws = createWorkspace(fasta, k, strands);
   
   /**
    * Convergence control
-   */  
+   */
   std::vector<double> convergence;
   std::vector<double> changes;
+  convergence.reserve(niter + 2);
+  changes.reserve(niter + 2);
   convergence.push_back(-std::numeric_limits<double>::infinity());
   changes.push_back(0);
   
   while (true) {
+    
+    /**
+     * E-STEP and M-STEP counts, parallel across sequences
+     */
     new_alpha.fill(1e-100);
-    for (const auto &seq : fasta) { // Foreach sequence
-      /**
-       * E-STEP
-       */
-      
-      std::atomic<double> marginal_prob(0.0);
-      tbb::parallel_for(0, m, 1, [&](int j) { // Using Intel parallel FOR
-        const auto &kmer = seq.substr(j, k);
-        double local_z = w * probSeqGivenPos(seq, alpha, beta, j);
-        z[j] = local_z;
-        double current_value = marginal_prob.load(std::memory_order_relaxed);
-        while (!marginal_prob.compare_exchange_weak(current_value, current_value + local_z, std::memory_order_relaxed));
-      });
-      
-      /**
-       * M-STEP
-       */
-      
-      z = z / marginal_prob.load();
-      update(new_alpha, seq, z.t());
-    }
+    new_w = 0.0;
+    logModel(alpha, alphalog);
+    estep(fasta, bg, alphalog, w, false, false, ws, new_alpha, new_w);
     
-    alpha = new_alpha / arma::accu(new_alpha.col(0));
+    normalizeModel(new_alpha, alpha);
     
     /**
      * Convergence control
@@ -85,63 +78,53 @@ arma::mat oops(const std::vector<std::string> &fasta, arma::mat alpha, const arm
 //'@param cutoff Cutoff for EM convergence.
 //'@param niter Maximum number of iterations.
 //'@param w Priori probability for motif belongs to position w1, w2, w3, ..., wm.
+//'@param strands STRAND_FORWARD, STRAND_BOTH or STRAND_PALINDROME.
 //'@param beta Markov model thats represents the control senquences.
-arma::mat logoops(const std::vector<std::string> &fasta, arma::mat alpha, const arma::mat &beta, double cutoff, int niter, double w = 1) {
+arma::mat logoops(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, double cutoff, int niter, double w = 1, const int strands = STRAND_FORWARD) {
   /**
    * Parameters
    */
   int n = fasta.size();
-  int t = fasta[0].size();
   int k = alpha.n_cols;
-  int m = t - k + 1;
+  
   /**
    * Model to reestimate
    */
   arma::mat new_alpha(4, k);
-  arma::vec new_w(m);
+  double new_w = 0.0;
+  
   /**
-   * Posteriori
+   * Background log-probabilities, fixed during EM
    */
-  arma::vec z(m);
+  const Background bg = backgroundPrefixes(fasta, beta);
+  arma::mat alphalog(4, k);
   
+  /**
+   * Accumulators of each chunk of sequences
+   */
+  EMWorkspace ws = createWorkspace(fasta, k, strands);
   
   /**
    * Convergence control
-   */  
+   */
   std::vector<double> convergence;
   std::vector<double> changes;
+  convergence.reserve(niter + 2);
+  changes.reserve(niter + 2);
   convergence.push_back(-std::numeric_limits<double>::infinity());
   changes.push_back(0);
   
   while (true) {
+    
+    /**
+     * E-STEP and M-STEP counts, parallel across sequences
+     */
     new_alpha.fill(1e-100);
-    for (const auto &seq : fasta) { // Foreach sequence
-      
-      /**
-       * E-STEP
-       */
-      
-      std::atomic<double> marginal_prob_atomic(0.0);
-      tbb::parallel_for(0, m, 1, [&](int j) {
-        const auto &kmer = seq.substr(j, k);
-        z[j] = std::log(w) + probSeqGivenPosLog(seq, alpha, beta, j);
-        
-        // Utiliza operações atômicas para atualizar marginal_prob
-        double local_z_exp = std::exp(z[j]);
-        double current_value = marginal_prob_atomic.load(std::memory_order_relaxed);
-        while (!marginal_prob_atomic.compare_exchange_weak(current_value, current_value + local_z_exp, std::memory_order_relaxed));
-      });
-      
-      double marginal_prob = marginal_prob_atomic.load();
-      
-      /**
-       * M-STEP
-       */
-      z = arma::exp(z - std::log(marginal_prob));
-      update(new_alpha, seq, z.t());
-    }
+    new_w = 0.0;
+    logModel(alpha, alphalog);
+    estep(fasta, bg, alphalog, w, false, true, ws, new_alpha, new_w);
     
-    alpha = new_alpha / arma::accu(new_alpha.col(0));
+    normalizeModel(new_alpha, alpha);
     
     /**
      * Convergence control
@@ -156,7 +139,3 @@ arma::mat logoops(const std::vector<std::string> &fasta, arma::mat alpha, const
   
   return alpha;
 }
-
-
-
-
@@ -6,6 +6,7 @@
 #include <tbb/parallel_for.h>
 #include <tbb/tbb.h>
 #include <atomic>
+#include "utils.h"
 
-arma::mat oops(const std::vector<std::string> &fasta, arma::mat alpha, const arma::mat &beta, double cutoff, int niter, double w);
-arma::mat logoops(const std::vector<std::string> &fasta, arma::mat alpha, const arma::mat &beta, double cutoff, int niter, double w);
+arma::mat oops(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, double cutoff, int niter, double w, const int strands);
+arma::mat logoops(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, double cutoff, int niter, double w, const int strands);
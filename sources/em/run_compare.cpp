@@ -0,0 +1,98 @@
+#include "compare.h"
+#include "utils.h"
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <fstream>
+
+int main(int argc, char *argv[]) {
+  
+  // Verificar se há número suficiente de argumentos
+  if (argc < 3) {
+    std::cerr << "Uso: compare -db <motifs in JASPAR format> options\nOptions:\n   -models <directory of the models, smt_data/models>\n   -metric <pcc, ed or kl>\n   -top <best matches of each model>\n   -null <shuffled copies of each motif in the null>\n   -o <output file, stdout if not set>\n";
+    return 1;
+  }
+  
+  std::string path = "";
+  std::string dir = "smt_data/models";
+  std::string metric_name = "pcc";
+  size_t top = 5;
+  int copies = COMPARE_NULL_COPIES;
+  std::string output = "";
+  
+  for (int i = 1; i < argc; i += 2) {
+    std::string arg = argv[i];
+  
+    if (arg == "-db") {
+      path = argv[i + 1];
+    }
+  
+    else if (arg == "-models") {
+      dir = argv[i + 1];
+    }
+  
+    else if (arg == "-metric") {
+      metric_name = argv[i + 1];
+    }
+  
+    else if (arg == "-top") {
+      top = std::stoul(argv[i + 1]);
+    }
+  
+    else if (arg == "-null") {
+      copies = std::max(std::stoi(argv[i + 1]), 1);
+    }
+  
+    else if (arg == "-o") {
+      output = argv[i + 1];
+    }
+  
+    else {
+      std::cerr << "Argumento desconhecido: " << arg << "\n";
+      return 1;
+    }
+  }
+  
+  const int metric = compareMetric(metric_name);
+  if (metric < 0) {
+    std::cerr << "Métrica inválida: precisa ser pcc, ed ou kl\n";
+    return 1;
+  }
+  
+  MotifStore db;
+  if (!readJaspar(path, db) || db.ids.empty()) {
+    std::cerr << "Banco de motivos inválido: " << path << "\n";
+    return 1;
+  }
+  
+  std::vector<std::string> names;
+  const std::vector<arma::mat> models = readModels(dir, names);
+  if (models.empty()) {
+    std::cerr << "Nenhum modelo encontrado em " << dir << "\n";
+    return 1;
+  }
+  
+  /**
+   * Database and null columns mapped once, every model reuses them
+   */
+  const MotifStore null = shuffleStore(db, copies, COMPARE_SEED);
+  const ColumnFeatures features = columnFeatures(db.columns, metric);
+  const ColumnFeatures null_features = columnFeatures(null.columns, metric);
+  
+  std::ofstream file;
+  if (!output.empty()) file.open(output);
+  std::ostream &out = output.empty() ? std::cout : file;
+  out << "model\ttarget\tname\tstrand\toffset\toverlap\tscore\tpvalue\tevalue\n";
+  
+  char line[128];
+  for (size_t i = 0; i < models.size(); ++i) {
+    const std::vector<MotifMatch> matches = compareModel(models[i], db, features, null, null_features);
+    for (size_t j = 0; j < std::min(top, matches.size()); ++j) {
+      const MotifMatch &match = matches[j];
+      std::snprintf(line, sizeof(line), "\t%c\t%d\t%d\t%.4f\t%.3e\t%.3e\n", match.strand, match.offset, match.overlap, match.score, match.pvalue, match.evalue);
+      out << names[i] << "\t" << db.ids[match.target] << "\t" << db.names[match.target] << line;
+    }
+  }
+  
+  return 0;
+}
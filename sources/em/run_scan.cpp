@@ -0,0 +1,188 @@
+#include "scan.h"
+#include "utils.h"
+#include "prob_utils.h"
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <fstream>
+#include <tbb/parallel_for.h>
+
+int main(int argc, char *argv[]) {
+  
+  // Verificar se há número suficiente de argumentos
+  if (argc < 3) {
+    std::cerr << "Uso: scan -i <fasta> options\nOptions:\n   -models <directory of the models, smt_data/models>\n   -pvalue <max p-value of a site>\n   -tau <order of the background Markov chain, up to 5>\n   -bg <background cache file, reused across runs>\n   -strands <1 or 2, scan the reverse strand too>\n   -format <bed or tsv>\n   -o <output file, stdout if not set>\n   -tile <max size of the tiles of long records>\n   -batch <records in memory at a time>\n";
+    return 1;
+  }
+  
+  std::string path = "";
+  std::string dir = "smt_data/models";
+  double pvalue = SCAN_PVALUE;
+  int tau = 0;
+  std::string cache = "";
+  int strands = 2;
+  std::string format = "bed";
+  std::string output = "";
+  size_t tile = SCAN_TILE;
+  size_t batch = SCAN_BATCH;
+  
+  for (int i = 1; i < argc; i += 2) {
+    std::string arg = argv[i];
+  
+    if (arg == "-i") {
+      path = argv[i + 1];
+    }
+  
+    else if (arg == "-models") {
+      dir = argv[i + 1];
+    }
+  
+    else if (arg == "-pvalue") {
+      pvalue = std::stod(argv[i + 1]);
+    }
+  
+    else if (arg == "-tau") {
+      tau = std::stoi(argv[i + 1]);
+    }
+  
+    else if (arg == "-bg") {
+      cache = argv[i + 1];
+    }
+  
+    else if (arg == "-strands") {
+      strands = std::stoi(argv[i + 1]) == 2 ? 2 : 1;
+    }
+  
+    else if (arg == "-format") {
+      format = argv[i + 1];
+    }
+  
+    else if (arg == "-o") {
+      output = argv[i + 1];
+    }
+  
+    else if (arg == "-tile") {
+      tile = std::stoul(argv[i + 1]);
+    }
+  
+    else if (arg == "-batch") {
+      batch = std::stoul(argv[i + 1]);
+    }
+  
+    else {
+      std::cerr << "Argumento desconhecido: " << arg << "\n";
+      return 1;
+    }
+  }
+  
+  if (tau < 0 || tau > MAX_TAU) {
+    std::cerr << "Ordem do background precisa estar entre 0 e " << MAX_TAU << "\n";
+    return 1;
+  }
+  
+  if (format != "bed" && format != "tsv") {
+    std::cerr << "Formato precisa ser bed ou tsv\n";
+    return 1;
+  }
+  
+  /**
+   * Models written by em, m1, m2, ... in numeric order
+   */
+  std::vector<std::string> names;
+  const std::vector<arma::mat> models = readModels(dir, names);
+  
+  if (models.empty()) {
+    std::cerr << "Nenhum modelo encontrado em " << dir << "\n";
+    return 1;
+  }
+  
+  /**
+   * Background of the whole file and score thresholds of each model and strand
+   */
+  const arma::mat beta = floorChain(cache.empty() ? streamMarkovChain(path, tau, BG_BATCH) : cachedMarkovChain(cache, path, tau));
+  const std::vector<arma::mat> tables = backgroundTables(beta);
+  
+  // Sites are scored with the floored models, the same scores of the distributions
+  std::vector<arma::mat> alphalogs;
+  for (const auto &alpha : models) {
+    alphalogs.push_back(arma::log(floorModel(alpha)));
+    if (strands == 2) alphalogs.push_back(alpha2rc(alphalogs.back()));
+  }
+  
+  std::vector<ScoreDistribution> dists(alphalogs.size());
+  std::vector<double> thresholds(alphalogs.size());
+  tbb::parallel_for(size_t(0), alphalogs.size(), [&](size_t e) {
+    dists[e] = scoreDistribution(alphalogs[e], tables);
+    thresholds[e] = scoreThreshold(dists[e], pvalue);
+  });
+  
+  int kmax = 0;
+  for (const auto &alpha : models) kmax = std::max<int>(kmax, alpha.n_cols);
+  
+  /**
+   * Scan the file in batches of tiles overlapping by kmax-1
+   */
+  FastaReader reader;
+  reader.tile = std::max<size_t>(tile, kmax);
+  reader.overlap = kmax - 1;
+  if (!openFasta(reader, path)) {
+    std::cerr << "Arquivo fasta não encontrado: " << path << "\n";
+    return 1;
+  }
+  
+  std::ofstream file;
+  if (!output.empty()) file.open(output);
+  std::ostream &out = output.empty() ? std::cout : file;
+  if (format == "tsv") out << "seq\tstart\tend\tmodel\tstrand\tscore\tpvalue\tsite\n";
+  
+  std::vector<std::string> fasta;
+  while (readFastaBatch(reader, batch, fasta) > 0) {
+    const EncodedFasta data = encodeFasta(fasta);
+    const Background bg = backgroundPrefixes(data, beta);
+    const auto &coords = reader.coords;
+    const size_t n = fasta.size();
+  
+    std::vector<std::vector<Site>> sites(n);
+    tbb::parallel_for(size_t(0), n, [&](size_t i) {
+      // Windows starting in the overlap belong to the next tile of the record
+      int m = data.length(i);
+      if (i + 1 < n && coords[i + 1].record == coords[i].record && coords[i + 1].start < coords[i].start + m) m = coords[i + 1].start - coords[i].start;
+      scanTile(data.seq(i), bg.seq(i), data.length(i), m, coords[i], alphalogs, dists, thresholds, strands, sites[i]);
+      std::sort(sites[i].begin(), sites[i].end(), [](const Site &a, const Site &b) {
+        return a.start != b.start ? a.start < b.start : a.model != b.model ? a.model < b.model : a.strand < b.strand;
+      });
+    });
+  
+    std::string buffer;
+    char line[128];
+    for (size_t i = 0; i < n; ++i) {
+      for (const auto &site : sites[i]) {
+        const std::string &record = reader.names[site.record];
+        const std::string &model = names[site.model];
+        const int k = models[site.model].n_cols;
+  
+        if (format == "bed") {
+          std::snprintf(line, sizeof(line), "\t%lu\t%lu\t", site.start, site.start + k);
+          buffer += record + line + model;
+          std::snprintf(line, sizeof(line), "\t%.4f\t%c\n", site.score, site.strand);
+          buffer += line;
+        }
+  
+        else {
+          std::string kmer = fasta[i].substr(site.start - coords[i].start, k);
+          if (site.strand == '-') {
+            std::reverse(kmer.begin(), kmer.end());
+            for (auto &c : kmer) c = int2char(3 - char2int(c));
+          }
+          std::snprintf(line, sizeof(line), "\t%lu\t%lu\t", site.start, site.start + k);
+          buffer += record + line + model;
+          std::snprintf(line, sizeof(line), "\t%c\t%.4f\t%.3e\t", site.strand, site.score, site.pvalue);
+          buffer += line + kmer + "\n";
+        }
+      }
+    }
+    out << buffer;
+  }
+  
+  return 0;
+}
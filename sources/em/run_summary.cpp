@@ -0,0 +1,51 @@
+#include "summary.h"
+#include "utils.h"
+#include <iostream>
+#include <string>
+
+int main(int argc, char *argv[]) {
+  
+  std::string dir = "smt_data/models";
+  std::string output = "smt_data/summary.txt";
+  bool logos = true;
+  
+  for (int i = 1; i < argc; i += 2) {
+    std::string arg = argv[i];
+  
+    if (i + 1 >= argc) {
+      std::cerr << "Uso: summary options\nOptions:\n   -models <directory of the models, smt_data/models>\n   -o <summary file, smt_data/summary.txt>\n   -logos <0 or 1, svg logo of each model>\n";
+      return 1;
+    }
+  
+    if (arg == "-models") {
+      dir = argv[i + 1];
+    }
+  
+    else if (arg == "-o") {
+      output = argv[i + 1];
+    }
+  
+    else if (arg == "-logos") {
+      logos = std::stoi(argv[i + 1]) != 0;
+    }
+  
+    else {
+      std::cerr << "Argumento desconhecido: " << arg << "\n";
+      return 1;
+    }
+  }
+  
+  std::vector<std::string> names;
+  const std::vector<arma::mat> models = readModels(dir, names);
+  if (models.empty()) {
+    std::cerr << "Nenhum modelo encontrado em " << dir << "\n";
+    return 1;
+  }
+  
+  saveSummary(names, models, output);
+  if (logos) {
+    for (size_t i = 0; i < models.size(); ++i) saveLogo(models[i], dir + "/" + names[i] + ".svg");
+  }
+  
+  return 0;
+}
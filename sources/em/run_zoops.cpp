@@ -1,4 +1,7 @@
 #include "zoops.h"
+#include "squarem.h"
+#include "online_em.h"
+#include "multistart.h"
 #include "utils.h"
 #include "prob_utils.h"
 #include <iostream>
@@ -14,7 +17,7 @@ int main(int argc, char *argv[]) {
   
   // Verificar se há número suficiente de argumentos
   if (argc < 9) {
-    std::cerr << "Uso: oops -i <fasta> options\nOptions:\n   -k <size of kmer>\n   -niter <number of em iterations>\n   -cutoff <small number for convergence controll>\n";
+    std::cerr << "Uso: oops -i <fasta> options\nOptions:\n   -k <size of kmer>\n   -niter <number of em iterations>\n   -cutoff <small number for convergence controll>\n   -squarem <0 or 1, SQUAREM acceleration>\n   -batch <sequences per mini-batch, online EM streaming the fasta>\n   -kappa <decay of the online EM step size>\n   -tau <order of the background Markov chain, up to 5>\n   -bg <background cache file, reused across runs>\n   -restarts <number of seeded restarts, cut by successive halving>\n   -seed <seed of the random starts>\n   -strands <1 or 2, score the reverse strand too>\n   -palindrome <0 or 1, keep the model equal to its reverse complement>\n   -tile <max size of the tiles of long records, 0 to keep whole records, streamed with -batch>\n   -start <consensus of the initial model, replaces the random start and -k>\n";
     return 1;
   }
   
@@ -22,6 +25,17 @@ int main(int argc, char *argv[]) {
   int niter = 0;
   double cutoff = 0.0;
   int k = 0;
+  bool accelerate = false;
+  size_t batch = 0;
+  double kappa = ONLINE_KAPPA;
+  int tau = 0;
+  std::string cache = "";
+  int restarts = 1;
+  unsigned seed = 1;
+  int strands = 1;
+  bool palindrome = false;
+  size_t tile = 0;
+  std::string start = "";
   
   for (int i = 1; i < argc; i += 2) {
     std::string arg = argv[i];
@@ -42,19 +56,119 @@ int main(int argc, char *argv[]) {
       k = std::stoi(argv[i + 1]);
     }
     
+    else if (arg == "-squarem") {
+      accelerate = std::stoi(argv[i + 1]) != 0;
+    }
+    
+    else if (arg == "-batch") {
+      batch = std::stoul(argv[i + 1]);
+    }
+    
+    else if (arg == "-kappa") {
+      kappa = std::stod(argv[i + 1]);
+    }
+    
+    else if (arg == "-tau") {
+      tau = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-bg") {
+      cache = argv[i + 1];
+    }
+    
+    else if (arg == "-restarts") {
+      restarts = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-seed") {
+      seed = std::stoul(argv[i + 1]);
+    }
+    
+    else if (arg == "-strands") {
+      strands = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-palindrome") {
+      palindrome = std::stoi(argv[i + 1]) != 0;
+    }
+    
+    else if (arg == "-tile") {
+      tile = std::stoul(argv[i + 1]);
+    }
+    
+    else if (arg == "-start") {
+      start = argv[i + 1];
+    }
+    
     else {
       std::cerr << "Argumento desconhecido: " << arg << "\n";
       return 1;
     }
   }
   
+  if (tau < 0 || tau > MAX_TAU) {
+    std::cerr << "Ordem do background precisa estar entre 0 e " << MAX_TAU << "\n";
+    return 1;
+  }
+  
+  // Both strands are scored in the same pass over each window
+  const int strand_mode = palindrome ? STRAND_PALINDROME : strands == 2 ? STRAND_BOTH : STRAND_FORWARD;
+  
+  std::mt19937 gen(seed);
+  
+  // A fixed start makes runs comparable, e.g. online and full EM
+  if (!start.empty()) k = start.size();
+  
+  // Online EM keeps only one mini-batch in memory
+  if (batch > 0) {
+    FastaReader reader;
+    reader.tile = tile;
+    reader.overlap = k - 1;
+    std::vector<std::string> first;
+    if (!openFasta(reader, path) || readFastaBatch(reader, batch, first) == 0) {
+      std::cerr << "Arquivo fasta vazio ou não encontrado: " << path << "\n";
+      return 1;
+    }
+    if (!hasKmers(first, k)) {
+      std::cerr << "Nenhuma sequência do primeiro lote tem tamanho " << k << " ou mais\n";
+      return 1;
+    }
+    arma::mat beta = cache.empty() ? streamMarkovChain(path, tau, batch) : cachedMarkovChain(cache, path, tau);
+    arma::mat alpha = start.empty() ? fasta2alpha(first, k, gen) : consensus2alpha(start);
+    int ret =  std::system("rm -Rf zoops/models");
+    ret = std::system("mkdir -p zoops/models");
+    arma::mat new_alpha = online_em(path, alpha, beta, cutoff, niter, 1.0, true, strand_mode, batch, kappa, tile);
+    new_alpha.save("zoops/models/m1", arma::csv_ascii);
+    return 0;
+  }
+  
   // Run oops EM
-  const auto fasta = readFasta(path);
-  arma::mat beta = createMarkovChain(fasta, 0);
-  arma::mat alpha = fasta2alpha(fasta, k);
+  // Long records in tiles overlapping by k-1, the background is counted once per symbol
+  std::vector<TileCoord> coords;
+  const auto fasta = tile > 0 ? readFastaTiles(path, tile, k - 1, coords) : readFasta(path);
+  if (!hasKmers(fasta, k)) {
+    std::cerr << "Nenhuma sequência de " << path << " tem tamanho " << k << " ou mais\n";
+    return 1;
+  }
+  const auto data = encodeFasta(fasta);
+  arma::mat beta = !cache.empty() ? cachedMarkovChain(cache, path, tau) : tile > 0 ? streamMarkovChain(path, tau, BG_BATCH) : createMarkovChain(fasta, tau);
+  arma::mat alpha = start.empty() ? fasta2alpha(fasta, k, gen) : consensus2alpha(start);
   int ret =  std::system("rm -Rf zoops/models");
   ret = std::system("mkdir -p zoops/models");
-  arma::mat new_alpha = zoops(fasta, alpha, beta, cutoff, niter, 1.0);  // Ajuste os argumentos conforme necessário
+  arma::mat new_alpha;
+  if (restarts > 1) {
+    std::vector<Restart> survivors;
+    new_alpha = multistart(fasta, data, k, beta, cutoff, niter, 1.0, true, strand_mode, restarts, seed, survivors);
+    std::ofstream report("zoops/restarts.txt");
+    report << "seed\tll\n";
+    for (auto it = survivors.rbegin(); it != survivors.rend(); ++it) report << it->seed << "\t" << it->ll << "\n";
+  }
+  else if (accelerate) {
+    std::vector<SquaremTrace> trace;
+    new_alpha = squarem(data, alpha, beta, cutoff, niter, 1.0, true, strand_mode, trace);
+    saveSquaremTrace(trace, "zoops/squarem.txt");
+  }
+  else new_alpha = zoops(data, alpha, beta, cutoff, niter, 1.0, strand_mode);  // Ajuste os argumentos conforme necessário
   new_alpha.save("zoops/models/m1", arma::csv_ascii);
   
   return 0;
@@ -0,0 +1,185 @@
+#include "scan.h"
+#include "prob_utils.h"
+#include "pwm_kernels.h"
+
+//'PWM model with every probability at least SCAN_FLOOR, columns renormalized. EM writes
+//'1e-100 into absent symbols, and a log of -230 would stretch the score grid so that each
+//'bin spans nats.
+//'@name floorModel
+//'@param alpha PWM model, 4 x k.
+//'@return Floored model, the one scan scores the sites with.
+arma::mat floorModel(const arma::mat &alpha) {
+  arma::mat floored(alpha);
+  for (size_t l = 0; l < floored.n_cols; ++l) {
+    double total = 0.0;
+    for (size_t c = 0; c < floored.n_rows; ++c) {
+      floored(c, l) = std::max(floored(c, l), SCAN_FLOOR);
+      total += floored(c, l);
+    }
+    for (size_t c = 0; c < floored.n_rows; ++c) floored(c, l) /= total;
+  }
+  
+  return floored;
+}
+
+//'Markov chain with every transition at least SCAN_FLOOR, rows renormalized. Unseen
+//'transitions are log(1e-300) in the background tables, a column score of +690.
+//'@name floorChain
+//'@param beta Markov chain with 4^tau rows.
+//'@return Floored chain, the background of the scores and of their distribution.
+arma::mat floorChain(const arma::mat &beta) {
+  return floorModel(beta.t()).t();
+}
+
+//'Exact distribution of the log-odds score of a PWM in background sequences, by dynamic
+//'programming over the discretized scores (as in TFM-Pvalue and FIMO). The window is
+//'preceded by tau background symbols drawn from the stationary distribution, and each
+//'symbol of the window adds log alpha - log beta of its context, as in the E-step.
+//'The grid step is the sum of the column ranges over the bins, so the model and the chain
+//'must come from floorModel and floorChain; each column adds at most eps/2 of rounding.
+//'@name scoreDistribution
+//'@param alphalog Log of the PWM model, floored.
+//'@param tables Tables of backgroundTables of a floored chain, the last one is the tau-order chain.
+//'@return Tail probabilities of the scores on a grid of at most SCAN_MAX_BINS bins.
+ScoreDistribution scoreDistribution(const arma::mat &alphalog, const std::vector<arma::mat> &tables) {
+  const int k = alphalog.n_cols;
+  const int tau = tables.size() - 1;
+  const size_t contexts = size_t(1) << (2 * tau);
+  const size_t mask = contexts - 1;
+  const arma::mat &trans = tables[tau];
+  
+  /**
+   * Grid step, the rounded scores of all columns fit in the bins
+   */
+  double range = 0.0;
+  for (int l = 0; l < k; ++l) {
+    double mn = std::numeric_limits<double>::infinity();
+    double mx = -mn;
+    for (size_t s = 0; s < contexts; ++s) {
+      for (int c = 0; c < 4; ++c) {
+        mn = std::min(mn, alphalog(c, l) - trans(s, c));
+        mx = std::max(mx, alphalog(c, l) - trans(s, c));
+      }
+    }
+    range += mx - mn;
+  }
+  const size_t max_bins = std::min<size_t>(SCAN_MAX_BINS, SCAN_CELLS / contexts);
+  
+  ScoreDistribution dist;
+  dist.eps = range > 0 ? range / (max_bins - 1 - k) : 1.0;
+  
+  std::vector<long> rounded(contexts * 4 * k);
+  std::vector<long> low(k), high(k);
+  size_t bins = 1;
+  for (int l = 0; l < k; ++l) {
+    low[l] = std::numeric_limits<long>::max();
+    high[l] = std::numeric_limits<long>::min();
+    for (size_t s = 0; s < contexts; ++s) {
+      for (int c = 0; c < 4; ++c) {
+        const long r = std::lround((alphalog(c, l) - trans(s, c)) / dist.eps);
+        rounded[(l * contexts + s) * 4 + c] = r;
+        low[l] = std::min(low[l], r);
+        high[l] = std::max(high[l], r);
+      }
+    }
+    bins += high[l] - low[l];
+    dist.offset += low[l];
+  }
+  
+  /**
+   * Stationary probability of each context from the marginal tables
+   */
+  std::vector<double> cur(contexts * bins, 0.0);
+  std::vector<double> next(contexts * bins);
+  for (size_t s = 0; s < contexts; ++s) {
+    double logp = 0.0;
+    for (int l = 0; l < tau; ++l) {
+      const size_t symbol = (s >> (2 * (tau - 1 - l))) & 3;
+      logp += tables[l](s >> (2 * (tau - l)), symbol);
+    }
+    cur[s * bins] = std::exp(logp);
+  }
+  
+  /**
+   * One column at a time, only the bins reached so far are visited
+   */
+  size_t width = 1;
+  for (int l = 0; l < k; ++l) {
+    std::fill(next.begin(), next.end(), 0.0);
+    for (size_t s = 0; s < contexts; ++s) {
+      const long *r = rounded.data() + (l * contexts + s) * 4;
+      for (int c = 0; c < 4; ++c) {
+        const double p = std::exp(trans(s, c));
+        if (p == 0) continue;
+        const size_t shift = r[c] - low[l];
+        const double *from = cur.data() + s * bins;
+        double *to = next.data() + (((s << 2) | c) & mask) * bins + shift;
+        for (size_t b = 0; b < width; ++b) to[b] += p * from[b];
+      }
+    }
+    cur.swap(next);
+    width += high[l] - low[l];
+  }
+  
+  dist.tail.assign(bins, 0.0);
+  for (size_t s = 0; s < contexts; ++s) {
+    for (size_t b = 0; b < bins; ++b) dist.tail[b] += cur[s * bins + b];
+  }
+  for (size_t b = bins - 1; b-- > 0; ) dist.tail[b] += dist.tail[b + 1];
+  
+  return dist;
+}
+
+//'Smallest score with a p-value not greater than pvalue.
+//'@name scoreThreshold
+//'@param dist Distribution of scoreDistribution.
+//'@param pvalue Max p-value of a site.
+//'@return Score threshold, infinity if no score is that rare.
+double scoreThreshold(const ScoreDistribution &dist, const double pvalue) {
+  for (size_t b = 0; b < dist.tail.size(); ++b) {
+    if (dist.tail[b] <= pvalue) return (long(b) + dist.offset - 0.5) * dist.eps;
+  }
+  
+  return std::numeric_limits<double>::infinity();
+}
+
+//'P-value of a score, from the bin of the score.
+//'@name scorePvalue
+//'@param dist Distribution of scoreDistribution.
+//'@param score Log-odds score of a site.
+//'@return Probability of a score as high in a background sequence.
+double scorePvalue(const ScoreDistribution &dist, const double score) {
+  const long b = std::lround(score / dist.eps) - dist.offset;
+  if (b <= 0) return 1.0;
+  return dist.tail[std::min<size_t>(b, dist.tail.size() - 1)];
+}
+
+//'Sites of all models in one tile. The log-PWM scores come from the vectorized kernel and
+//'the background of each window from the prefix sums, as in the E-step.
+//'@name scanTile
+//'@param seq Encoded tile.
+//'@param prefix Background prefix sums of the tile.
+//'@param t Size of the tile.
+//'@param m Number of windows owned by the tile, the next ones belong to the next tile.
+//'@param coord Position of the tile in the fasta file.
+//'@param alphalogs Log-PWM of each model and strand, strands entries per model.
+//'@param dists Score distribution of each entry of alphalogs.
+//'@param thresholds Score threshold of each entry of alphalogs.
+//'@param strands 1 for the forward strand, 2 for both.
+//'@param sites Receives the sites above the thresholds.
+void scanTile(const uint8_t *seq, const double *prefix, const int t, const int m, const TileCoord &coord, const std::vector<arma::mat> &alphalogs, const std::vector<ScoreDistribution> &dists, const std::vector<double> &thresholds, const int strands, std::vector<Site> &sites) {
+  std::vector<double> z(t);
+  
+  for (size_t e = 0; e < alphalogs.size(); ++e) {
+    const int k = alphalogs[e].n_cols;
+    const int w = std::min(m, t - k + 1);
+    if (w <= 0) continue;
+  
+    pwmScores(seq, w, alphalogs[e].memptr(), k, z.data());
+    for (int j = 0; j < w; ++j) {
+      const double score = z[j] - (prefix[j + k] - prefix[j]);
+      if (score < thresholds[e]) continue;
+      sites.push_back({coord.record, coord.start + j, int(e / strands), e % strands ? '-' : '+', score, scorePvalue(dists[e], score)});
+    }
+  }
+}
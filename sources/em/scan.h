@@ -0,0 +1,38 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <string>
+#include "utils.h"
+
+#define SCAN_MAX_BINS 65536    // Max number of score bins of the exact distribution
+#define SCAN_CELLS 4194304     // Max contexts x bins of the dynamic programming, about 32MB per layer
+#define SCAN_PVALUE 1e-4
+#define SCAN_FLOOR 1e-3       // Min probability of the models and background transitions, bounds the column scores
+#define SCAN_TILE 100000       // Max size of the tiles of long records
+#define SCAN_BATCH 10000       // Records in memory at a time
+
+// Exact null distribution of the log-odds score of a PWM against a Markov background,
+// on a grid of step eps. Bin b holds the score (b + offset) * eps and tail[b] is the
+// probability of a score greater or equal to it.
+struct ScoreDistribution {
+  double eps = 0.0;
+  long offset = 0;
+  std::vector<double> tail;
+};
+
+// Motif site found by scan.
+struct Site {
+  uint32_t record;   // Index of the record in the fasta file
+  uint64_t start;    // Offset of the site in the record, from 0
+  int model;         // Index of the model
+  char strand;       // + or -
+  double score;      // Log-odds against the background
+  double pvalue;     // Probability of a score as high in a background sequence
+};
+
+arma::mat floorModel(const arma::mat &alpha);
+arma::mat floorChain(const arma::mat &beta);
+ScoreDistribution scoreDistribution(const arma::mat &alphalog, const std::vector<arma::mat> &tables);
+double scoreThreshold(const ScoreDistribution &dist, const double pvalue);
+double scorePvalue(const ScoreDistribution &dist, const double score);
+void scanTile(const uint8_t *seq, const double *prefix, const int t, const int m, const TileCoord &coord, const std::vector<arma::mat> &alphalogs, const std::vector<ScoreDistribution> &dists, const std::vector<double> &thresholds, const int strands, std::vector<Site> &sites);
@@ -0,0 +1,136 @@
+#include "screen.h"
+#include "prob_utils.h"
+#include <fstream>
+
+//'Similarity of two seed models, the mean Pearson correlation of the aligned columns.
+//'Shifts up to SCREEN_MAX_SHIFT * k in both directions are tried.
+//'@name seedSimilarity
+//'@param a PWM model.
+//'@param b PWM model with the same size.
+//'@param shift Receives the best shift of b against a.
+//'@return Similarity of the best shift, columns outside the overlap count as 0.
+double seedSimilarity(const arma::mat &a, const arma::mat &b, int &shift) {
+  const int k = a.n_cols;
+  const int maxshift = int(SCREEN_MAX_SHIFT * k);
+  double best = -1.0;
+  shift = 0;
+  
+  for (int s = -maxshift; s <= maxshift; ++s) {
+    double sum = 0.0;
+    for (int l = std::max(0, s); l < std::min(k, k + s); ++l) {
+      const arma::vec x = a.col(l) - 0.25;
+      const arma::vec y = b.col(l - s) - 0.25;
+      const double den = std::sqrt(arma::accu(x % x) * arma::accu(y % y));
+      if (den > 0) sum += arma::accu(x % y) / den;
+    }
+    const double similarity = sum / k;
+    if (similarity > best) {
+      best = similarity;
+      shift = s;
+    }
+  }
+  
+  return best;
+}
+
+//'Screens seed models before EM. All seeds are scored with one E-step over the dataset,
+//'then greedily clustered from the best log-likelihood down: a seed joins the cluster of
+//'the first kept seed it matches, on either strand, and is dropped.
+//'@name screen_seeds
+//'@param fasta Encoded dataset of sequences.
+//'@param alphas Seed models, one slice per seed.
+//'@param beta Markov model thats represents the control senquences.
+//'@param w Priori probability, 1 for OOPS.
+//'@param zoops Score as ZOOPS if true, OOPS otherwise.
+//'@param keep Max number of distinct seeds to forward.
+//'@param scores Receives the score and cluster of every seed.
+//'@return Index of the forwarded seeds, best first.
+std::vector<int> screen_seeds(const EncodedFasta &fasta, const arma::cube &alphas, const arma::mat &beta, const double w, const bool zoops, const int keep, std::vector<SeedScore> &scores) {
+  const int k = alphas.n_cols;
+  const int nseeds = alphas.n_slices;
+  
+  /**
+   * One E-step for all seeds, per chunk log-likelihoods folded in order
+   */
+  const Background bg = backgroundPrefixes(fasta, beta);
+  arma::cube alphalogs(4, k, nseeds);
+  for (int a = 0; a < nseeds; ++a) alphalogs.slice(a) = arma::log(alphas.slice(a));
+  const std::vector<size_t> lengths = sequenceLengths(fasta);
+  const std::vector<size_t> sequences = lengthOrder(lengths, k);
+  const std::vector<size_t> bounds = lengthBatches(lengths, sequences, k, EM_CHUNK);
+  const size_t nchunks = bounds.empty() ? 0 : bounds.size() - 1;
+  std::vector<arma::vec> ll(nchunks, arma::vec(nseeds, arma::fill::zeros));
+  
+  tbb::parallel_for(size_t(0), nchunks, [&](size_t c) {
+    std::vector<double> z;
+    for (size_t p = bounds[c]; p < bounds[c + 1]; ++p) {
+      const size_t i = sequences[p];
+      z.resize(std::max(z.size(), lengths[i] - k + 1));
+      for (int a = 0; a < nseeds; ++a) {
+        ll[c][a] += posterior(fasta.seq(i), bg.seq(i), fasta.length(i), alphalogs.slice(a).memptr(), nullptr, k, w, zoops, false, z.data());
+      }
+    }
+  });
+  
+  scores.resize(nseeds);
+  for (int a = 0; a < nseeds; ++a) {
+    double sum = 0.0;
+    for (size_t c = 0; c < nchunks; ++c) sum += ll[c][a];
+    scores[a] = {a, sum, computeICU(alphas.slice(a)), a, 0, false};
+  }
+  
+  /**
+   * Greedy clustering by log-likelihood, ties broken by information content
+   */
+  std::vector<int> order(nseeds);
+  for (int a = 0; a < nseeds; ++a) order[a] = a;
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return scores[a].ll != scores[b].ll ? scores[a].ll > scores[b].ll : scores[a].ic > scores[b].ic;
+  });
+  
+  std::vector<int> kept;
+  std::vector<arma::mat> kept_rc;
+  for (const int a : order) {
+    const arma::mat &alpha = alphas.slice(a);
+    bool duplicate = false;
+    
+    for (size_t r = 0; r < kept.size() && !duplicate; ++r) {
+      int shift = 0, shift_rc = 0;
+      const double forward = seedSimilarity(alphas.slice(kept[r]), alpha, shift);
+      const double reverse = seedSimilarity(kept_rc[r], alpha, shift_rc);
+      if (std::max(forward, reverse) >= SCREEN_SIMILARITY) {
+        scores[a].cluster = kept[r];
+        scores[a].rc = reverse > forward;
+        scores[a].shift = scores[a].rc ? shift_rc : shift;
+        duplicate = true;
+      }
+    }
+    
+    if (!duplicate) {
+      kept.push_back(a);
+      kept_rc.push_back(alpha2rc(alpha));
+    }
+  }
+  
+  if (int(kept.size()) > keep) kept.resize(keep);
+  
+  return kept;
+}
+
+//'Save the screening of the seeds.
+//'@name saveScreen
+//'@param scores Scores of screen_seeds.
+//'@param path Output file, tab separated.
+//'@return True if the file was written.
+bool saveScreen(const std::vector<SeedScore> &scores, const std::string &path) {
+  std::ofstream file(path);
+  if (!file.is_open()) return false;
+  
+  file.precision(10);
+  file << "seed\tll\tic\tcluster\tshift\tstrand\n";
+  for (const auto &score : scores) {
+    file << score.seed + 1 << "\t" << score.ll << "\t" << score.ic << "\t" << score.cluster + 1 << "\t" << score.shift << "\t" << (score.rc ? "-" : "+") << "\n";
+  }
+  
+  return file.good();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <string>
+#include <tbb/parallel_for.h>
+#include <tbb/tbb.h>
+#include "utils.h"
+
+#define SCREEN_SIMILARITY 0.8    // Mean column correlation of near-duplicate seeds
+#define SCREEN_MAX_SHIFT 0.25    // Max shift between seeds, as a fraction of k
+
+// Screening result of one seed model.
+struct SeedScore {
+  int seed;           // Index of the seed in the input
+  double ll;          // Log-likelihood relative to the background, one E-step
+  double ic;          // Information content from a uniform distribution
+  int cluster;        // Index of the seed that represents its cluster
+  int shift;          // Shift against the representative
+  bool rc;            // Similar to the reverse complement of the representative
+};
+
+double seedSimilarity(const arma::mat &a, const arma::mat &b, int &shift);
+std::vector<int> screen_seeds(const EncodedFasta &fasta, const arma::cube &alphas, const arma::mat &beta, const double w, const bool zoops, const int keep, std::vector<SeedScore> &scores);
+bool saveScreen(const std::vector<SeedScore> &scores, const std::string &path);
@@ -0,0 +1,175 @@
+#include "squarem.h"
+#include "prob_utils.h"
+#include <fstream>
+
+//'One EM map, E-step and M-step, from alpha and w.
+//'@name emMap
+//'@param fasta Encoded dataset of sequences.
+//'@param bg Background prefixes of the dataset.
+//'@param alpha PWM model.
+//'@param w Priori probability, 1 for OOPS.
+//'@param zoops ZOOPS if true, OOPS otherwise.
+//'@param ws Accumulators of the E-step.
+//'@param alphalog Buffer of the log-PWM, same size as alpha.
+//'@param new_alpha Reestimated model, same size as alpha.
+//'@param new_w Reestimated priori probability.
+//'@return Log-likelihood of alpha and w, from the E-step normalizers.
+static double emMap(const EncodedFasta &fasta, const Background &bg, const arma::mat &alpha, const double w, const bool zoops, EMWorkspace &ws, arma::mat &alphalog, arma::mat &new_alpha, double &new_w) {
+  logModel(alpha, alphalog);
+  new_alpha.fill(1e-100);
+  double sumz = 0.0;
+  double ll = estep(fasta, bg, alphalog, w, zoops, false, ws, new_alpha, sumz);
+  normalizeModel(new_alpha, new_alpha);
+  new_w = zoops ? sumz / ws.order.size() : w;
+  return ll;
+}
+
+//'Runs Expectation Maximization OOPS or ZOOPS accelerated by SQUAREM (Varadhan and Roland, 2008).
+//'Each cycle extrapolates along the secant of two EM maps with step length -|r|/|v| and
+//'stabilizes the result with one more EM map. The step length is bounded by a maximum that
+//'grows while the steps are accepted. If the extrapolated point lowers the
+//'log-likelihood the cycle falls back to the second EM map, so the log-likelihood never
+//'decreases. Convergence is checked on the log-likelihood per sequence.
+//'@name squarem
+//'@param fasta Encoded dataset of sequences.
+//'@param alpha PWM model to be reestimated.
+//'@param beta Markov model thats represents the control senquences.
+//'@param cutoff Cutoff for the change of log-likelihood per sequence.
+//'@param niter Maximum number of EM maps.
+//'@param w Initial priori probability, 1 for OOPS.
+//'@param zoops ZOOPS if true, OOPS otherwise.
+//'@param strands STRAND_FORWARD, STRAND_BOTH or STRAND_PALINDROME.
+//'@param trace Telemetry of each cycle.
+//'@return Updated PWM model.
+arma::mat squarem(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w, const bool zoops, const int strands, std::vector<SquaremTrace> &trace) {
+  /**
+   * Parameters
+   */
+  const size_t n = fasta.size();
+  const int k = alpha.n_cols;
+  
+  /**
+   * Background log-probabilities, fixed during EM
+   */
+  const Background bg = backgroundPrefixes(fasta, beta);
+  EMWorkspace ws = createWorkspace(fasta, k, strands);
+  
+  /**
+   * Secant points, and the buffers of the extrapolation reused by every cycle
+   */
+  arma::mat alpha1(4, k), alpha2(4, k), alpha3(4, k);
+  arma::mat r(4, k), v(4, k), extrapolated(4, k), alphalog(4, k);
+  double w1 = w, w2 = w, w3 = w;
+  
+  /**
+   * Convergence control
+   */
+  std::vector<double> lls;
+  lls.reserve(niter + 2);
+  lls.push_back(-std::numeric_limits<double>::infinity());
+  int evaluations = 0;
+  double stepmax = 1.0;
+  
+  trace.clear();
+  trace.reserve(niter / 3 + 2);
+  for (int cycle = 1; ; ++cycle) {
+    
+    /**
+     * Two EM maps
+     */
+    const double ll0 = emMap(fasta, bg, alpha, w, zoops, ws, alphalog, alpha1, w1);
+    const double ll1 = emMap(fasta, bg, alpha1, w1, zoops, ws, alphalog, alpha2, w2);
+    evaluations += 2;
+    niter -= 2;
+    
+    if (hasConvergedLL(cutoff, niter, ll0, n, lls)) {
+      trace.push_back({cycle, evaluations, ll0, -1.0, false, 0.0});
+      alpha = alpha2;
+      break;
+    }
+    
+    /**
+     * Extrapolation, r = F(x) - x and v = F(F(x)) - 2F(x) + x
+     */
+    const double rw = zoops ? w1 - w : 0.0;
+    const double vw = zoops ? w2 - 2 * w1 + w : 0.0;
+    double sr = rw * rw, sv = vw * vw;
+    for (size_t i = 0; i < alpha.n_elem; ++i) {
+      r[i] = alpha1[i] - alpha[i];
+      v[i] = alpha2[i] - 2.0 * alpha1[i] + alpha[i];
+      sr += r[i] * r[i];
+      sv += v[i] * v[i];
+    }
+    const double step = sv > 0 ? std::max(-stepmax, std::min(-1.0, -std::sqrt(sr / sv))) : -1.0;
+    
+    // Project back to the simplex of each column
+    for (int j = 0; j < k; ++j) {
+      double total = 0.0;
+      for (int c = 0; c < 4; ++c) {
+        extrapolated(c, j) = std::min(std::max(alpha(c, j) - 2.0 * step * r(c, j) + step * step * v(c, j), 1e-10), 1.0);
+        total += extrapolated(c, j);
+      }
+      for (int c = 0; c < 4; ++c) extrapolated(c, j) /= total;
+    }
+    double wx = zoops ? std::min(std::max(w - 2 * step * rw + step * step * vw, 1e-6), 1 - 1e-6) : w;
+    
+    /**
+     * Stabilization and monotone safeguard
+     */
+    const double llx = emMap(fasta, bg, extrapolated, wx, zoops, ws, alphalog, alpha3, w3);
+    evaluations += 1;
+    niter -= 1;
+    
+    const bool accepted = llx >= ll1;
+    if (accepted) {
+      alpha = alpha3;
+      w = w3;
+      if (step == -stepmax) stepmax *= SQUAREM_MSTEP;
+    }
+    
+    else {
+      alpha = alpha2;
+      w = w2;
+      stepmax = std::max(1.0, stepmax / SQUAREM_MSTEP);
+    }
+    
+    /**
+     * Plain EM iterations needed for the same gain, assuming the gains of plain EM
+     * decay geometrically with the squared contraction of the secant
+     */
+    const double g0 = ll1 - ll0;
+    const double gain = (accepted ? llx : ll1) - ll0;
+    double contraction = (w2 - w1) * (w2 - w1);
+    for (size_t i = 0; i < alpha.n_elem; ++i) contraction += (alpha2[i] - alpha1[i]) * (alpha2[i] - alpha1[i]);
+    const double q = sr > 0 ? contraction / sr : 1.0;
+    double plain = 3.0;
+    if (g0 > 0 && q < 1) {
+      const double x = 1 - gain * (1 - q) / g0;
+      plain = std::min(std::log(std::max(x, SQUAREM_GAIN_TOL)) / std::log(q) + 1, niter + 3.0);
+    }
+    trace.push_back({cycle, evaluations, ll0, step, accepted, std::max(plain, 3.0) - 3});
+    
+    if (niter <= 0) break;
+  }
+  
+  return alpha;
+}
+
+//'Save the telemetry of SQUAREM.
+//'@name saveSquaremTrace
+//'@param trace Telemetry of each cycle.
+//'@param path Output file, tab separated, with the cumulative iterations saved.
+//'@return True if the file was written.
+bool saveSquaremTrace(const std::vector<SquaremTrace> &trace, const std::string &path) {
+  std::ofstream file(path);
+  if (!file.is_open()) return false;
+  
+  file << "iteration\tevaluations\tll\tstep\taccepted\tsaved\n";
+  double saved = 0.0;
+  for (const auto &cycle : trace) {
+    saved += cycle.saved;
+    file << cycle.iteration << "\t" << cycle.evaluations << "\t" << cycle.ll << "\t" << cycle.step << "\t" << cycle.accepted << "\t" << saved << "\n";
+  }
+  
+  return file.good();
+}
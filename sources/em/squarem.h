@@ -0,0 +1,22 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <string>
+#include "utils.h"
+
+#define SQUAREM_MSTEP 4.0        // Growth of the maximum step length
+#define SQUAREM_GAIN_TOL 1e-3    // Fraction of the plain EM gain left when estimating iterations saved
+
+// Telemetry of one SQUAREM cycle. A cycle costs three EM maps: two to build the
+// secant and one to stabilize the extrapolated point.
+struct SquaremTrace {
+  int iteration;      // Cycle number
+  int evaluations;    // EM maps evaluated so far
+  double ll;          // Log-likelihood at the start of the cycle, relative to the background
+  double step;        // Step length of the extrapolation
+  bool accepted;      // False if the monotone safeguard fell back to the plain EM step
+  double saved;       // Estimated EM iterations saved by the cycle
+};
+
+arma::mat squarem(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w, const bool zoops, const int strands, std::vector<SquaremTrace> &trace);
+bool saveSquaremTrace(const std::vector<SquaremTrace> &trace, const std::string &path);
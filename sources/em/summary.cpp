@@ -0,0 +1,166 @@
+#include "summary.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <algorithm>
+
+//'Information content of a model and its p-values, the same statistics of the R summary.
+//'The score of each cell is pssm = p * log2(p / 0.25), the observed ic weights it by the
+//'model and its null mean and variance weight it by the uniform background.
+//'@name summarizeModel
+//'@param alpha PWM model, 4 x k.
+//'@return ic, its null mean and standard deviation, normal and Gumbel p-values.
+ModelSummary summarizeModel(const arma::mat &alpha) {
+  ModelSummary s = {0.0, 0.0, 0.0, 1.0, 1.0};
+  double vx = 0.0;
+  
+  for (size_t l = 0; l < alpha.n_cols; ++l) {
+    double m1 = 0.0, m2 = 0.0;
+    for (int c = 0; c < 4; ++c) {
+      const double p = alpha(c, l);
+      const double pssm = p > 0 ? p * (std::log2(p) + 2.0) : 0.0;
+      s.ic += pssm * p;
+      m1 += pssm * .25;
+      m2 += pssm * pssm * .25;
+    }
+    s.ex += m1;
+    vx += m2 - m1 * m1;
+  }
+  s.sx = std::sqrt(vx);
+  if (s.sx == 0) return s;
+  
+  const double scale = s.sx * std::sqrt(6.0) / M_PI;
+  const double loc = s.ex - EULER_GAMMA * scale;
+  s.pvn = .5 * std::erfc((s.ic - s.ex) / (s.sx * M_SQRT2));
+  s.pvg = -std::expm1(-std::exp(-(s.ic - loc) / scale));
+  
+  return s;
+}
+
+// Number as R prints it after round, as.character with 15 significant digits. As R with
+// scipen 0, the fewest significant digits that keep the value are used, and scientific
+// notation is used when it is narrower than fixed notation, so 1e-04 but 0.0012.
+static std::string formatRounded(const double x, const int digits) {
+  const double p = std::pow(10.0, digits);
+  const double r = std::round(x * p) / p + 0.0;
+  if (r == 0.0) return "0";
+  
+  /**
+   * Significant digits and power of ten of the value at 15 digits
+   */
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), "%.14e", r);
+  const char *e = std::strchr(buffer, 'e');
+  const int kpower = std::atoi(e + 1);
+  int nsig = 15;
+  while (nsig > 1 && e[-1 - (15 - nsig)] == '0') --nsig;
+  
+  /**
+   * Widths without the sign, the exponent has at least 2 digits
+   */
+  const int rgt = std::max(nsig - kpower - 1, 0);
+  const int fixed = (kpower >= 0 ? kpower + 1 : 1) + (rgt > 0 ? rgt + 1 : 0);
+  const int sci = (nsig > 1 ? nsig + 1 : 1) + (std::abs(kpower) >= 100 ? 5 : 4);
+  
+  if (fixed > sci) std::snprintf(buffer, sizeof(buffer), "%.*e", nsig - 1, r);
+  else std::snprintf(buffer, sizeof(buffer), "%.*f", rgt, r);
+  return buffer;
+}
+
+//'Writes summary.txt with the p-value and the rounded PWM of each model, in the layout of
+//'the R summary.
+//'@name saveSummary
+//'@param names Name of each model, as in smt_data/models.
+//'@param models PWM models, 4 x k.
+//'@param path Output file.
+void saveSummary(const std::vector<std::string> &names, const std::vector<arma::mat> &models, const std::string &path) {
+  std::ofstream out(path);
+  const char *nucleotides = "ACGT";
+  
+  char date[64];
+  const std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%a %b %d %H:%M:%S %Y", std::localtime(&now));
+  out << "Biomapp::chip " << date << "\n\n";
+  
+  for (size_t i = 0; i < models.size(); ++i) {
+    const ModelSummary s = summarizeModel(models[i]);
+    out << "Model " << names[i] << " > p-value: " << formatRounded(s.pvg, 5) << ": \n";
+    for (int c = 0; c < 4; ++c) {
+      out << nucleotides[c];
+      for (size_t l = 0; l < models[i].n_cols; ++l) out << "\t" << formatRounded(models[i](c, l), 3);
+      out << "\n";
+    }
+    out << "\n\n";
+  }
+}
+
+//'Sequence logo of a model as SVG, without R. Each column is scaled by its information
+//'content, 2 - H bits, and its letters are stacked by probability, the largest on top.
+//'@name saveLogo
+//'@param alpha PWM model, 4 x k.
+//'@param path Output file.
+void saveLogo(const arma::mat &alpha, const std::string &path) {
+  // Glyphs in a 100 x 100 box
+  static const char *glyphs[4] = {
+    "M0 100L38 0L62 0L100 100L78 100L69 76L31 76L22 100ZM38 58L62 58L50 24Z",
+    "M88.3 17.9A50 50 0 1 0 88.3 82.1L73 69.3A30 30 0 1 1 73 30.7Z",
+    "M88.3 17.9A50 50 0 1 0 100 50L55 50L55 64L76.5 64A30 30 0 1 1 73 30.7Z",
+    "M0 0L100 0L100 18L59 18L59 100L41 100L41 18L0 18Z"
+  };
+  static const char *colors[4] = {"green", "blue", "orange", "red"};
+  
+  const int k = alpha.n_cols;
+  const int left = 50, top = 10, bottom = 30;
+  const int width = left + k * LOGO_WIDTH + 10;
+  const int height = top + LOGO_HEIGHT + bottom;
+  const int base = top + LOGO_HEIGHT;
+  
+  std::ostringstream svg;
+  svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height << "\" viewBox=\"0 0 " << width << " " << height << "\">\n";
+  svg << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+  svg << "<g font-family=\"sans-serif\" font-size=\"12\">\n";
+  
+  /**
+   * Axis in bits
+   */
+  svg << "<line x1=\"" << left - 5 << "\" y1=\"" << top << "\" x2=\"" << left - 5 << "\" y2=\"" << base << "\" stroke=\"black\"/>\n";
+  for (int b = 0; b <= 2; ++b) {
+    const int y = base - b * LOGO_HEIGHT / 2;
+    svg << "<line x1=\"" << left - 10 << "\" y1=\"" << y << "\" x2=\"" << left - 5 << "\" y2=\"" << y << "\" stroke=\"black\"/>\n";
+    svg << "<text x=\"" << left - 13 << "\" y=\"" << y + 4 << "\" text-anchor=\"end\">" << b << "</text>\n";
+  }
+  svg << "<text transform=\"translate(12 " << top + LOGO_HEIGHT / 2 << ") rotate(-90)\" text-anchor=\"middle\">Information content</text>\n";
+  
+  /**
+   * Stacked letters of each column
+   */
+  char transform[128];
+  for (int l = 0; l < k; ++l) {
+    double entropy = 0.0;
+    for (int c = 0; c < 4; ++c) {
+      if (alpha(c, l) > 0) entropy -= alpha(c, l) * std::log2(alpha(c, l));
+    }
+    const double ic = std::max(2.0 - entropy, 0.0);
+  
+    int order[4] = {0, 1, 2, 3};
+    std::sort(order, order + 4, [&](int a, int b) { return alpha(a, l) < alpha(b, l); });
+  
+    const double x = left + l * LOGO_WIDTH;
+    double y = base;
+    for (const int c : order) {
+      const double h = alpha(c, l) * ic * LOGO_HEIGHT / 2;
+      if (h < .01) continue;
+      y -= h;
+      std::snprintf(transform, sizeof(transform), "translate(%.2f %.2f) scale(%.4f %.4f)", x + 1, y, (LOGO_WIDTH - 2) / 100.0, h / 100.0);
+      svg << "<path d=\"" << glyphs[c] << "\" fill=\"" << colors[c] << "\" fill-rule=\"evenodd\" transform=\"" << transform << "\"/>\n";
+    }
+    svg << "<text x=\"" << x + LOGO_WIDTH / 2 << "\" y=\"" << base + 18 << "\" text-anchor=\"middle\">" << l + 1 << "</text>\n";
+  }
+  
+  svg << "</g>\n</svg>\n";
+  std::ofstream(path) << svg.str();
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <string>
+
+#define EULER_GAMMA 0.57722
+#define LOGO_WIDTH 30      // Width of a column of the logo, in pixels
+#define LOGO_HEIGHT 200    // Height of 2 bits, in pixels
+
+// Significance of a model, as in the R summary. The information content is compared
+// with its distribution over uniform sequences, by a normal and a Gumbel approximation.
+struct ModelSummary {
+  double ic;     // Information content weighted by the model
+  double ex;     // Mean of ic over uniform sequences
+  double sx;     // Standard deviation of ic over uniform sequences
+  double pvn;    // Normal p-value
+  double pvg;    // Gumbel p-value
+};
+
+ModelSummary summarizeModel(const arma::mat &alpha);
+void saveSummary(const std::vector<std::string> &names, const std::vector<arma::mat> &models, const std::string &path);
+void saveLogo(const arma::mat &alpha, const std::string &path);
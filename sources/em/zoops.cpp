@@ -10,67 +10,53 @@
 //'@param cutoff Cutoff for EM convergence.
 //'@param niter Maximum number of iterations.
 //'@param w Priori probability to each sequence has a motif.
+//'@param strands STRAND_FORWARD, STRAND_BOTH or STRAND_PALINDROME.
 //'@return Updated PWM model.
-arma::mat zoops(const std::vector<std::string> &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w = 0.5) {
+arma::mat zoops(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w = 0.5, const int strands = STRAND_FORWARD) {
   /**
    * Parameters
    */
-  int n = fasta.size();
-  int t = fasta[0].size();
   int k = alpha.n_cols;
-  int m = t - k + 1;
-  /**
-   * Posteriori
-   */
-  arma::vec z(m);
+  
   /**
    * Model to reestimate
    */
   arma::mat new_alpha(4, k);
   double new_w = 0.0;
   
+  /**
+   * Background log-probabilities, fixed during EM
+   */
+  const Background bg = backgroundPrefixes(fasta, beta);
+  arma::mat alphalog(4, k);
+  
+  /**
+   * Accumulators of each chunk of sequences
+   */
+  EMWorkspace ws = createWorkspace(fasta, k, strands);
   
   /**
    * Convergence control
    */
   std::vector<double> convergence;
   std::vector<double> changes;
+  convergence.reserve(niter + 2);
+  changes.reserve(niter + 2);
   convergence.push_back(-std::numeric_limits<double>::infinity());
   changes.push_back(0);
   
   while (true) {
     
+    /**
+     * E-STEP and M-STEP counts, parallel across sequences
+     */
     new_alpha.fill(1e-100);
     new_w = 0.0;
-    for (const auto &seq : fasta) { // Foreach sequence
-      
-      /**
-       * E-STEP
-       */
-      
-      std::atomic<double> marginal_prob(0.0);
-      tbb::parallel_for(0, m, 1, [&](int j) { // Using Intel parallel FOR
-        const auto &kmer = seq.substr(j, k);
-        double local_z = w * probSeqGivenPos(seq, alpha, beta, j);
-        z[j] = local_z;
-        double current_value = marginal_prob.load(std::memory_order_relaxed);
-        while (!marginal_prob.compare_exchange_weak(current_value, current_value + local_z, std::memory_order_relaxed));
-      });
-      
-      // zoops
-      double q = m * probSeqGivenBeta(seq, beta) * (1-w);
-      
-      /**
-       * M-STEP
-       */
-      
-      z = z / (marginal_prob.load() + q);
-      new_w += arma::accu(z);
-      update(new_alpha, seq, z.t());
-    }
-    double sumcol = arma::accu(new_alpha.col(0));
-    alpha = new_alpha / sumcol;
-    w = new_w / n;
+    logModel(alpha, alphalog);
+    estep(fasta, bg, alphalog, w, true, false, ws, new_alpha, new_w);
+    
+    normalizeModel(new_alpha, alpha);
+    w = new_w / ws.order.size();
     
     /**
      * Convergence control
@@ -94,20 +80,13 @@ arma::mat zoops(const std::vector<std::string> &fasta, arma::mat alpha, const ar
 //'@param cutoff Cutoff for EM convergence.
 //'@param niter Maximum number of iterations.
 //'@param w Priori probability to each sequence has a motif.
+//'@param strands STRAND_FORWARD, STRAND_BOTH or STRAND_PALINDROME.
 //'@return Updated PWM model.
-arma::mat logzoops(const std::vector<std::string> &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w = 0.5) {
+arma::mat logzoops(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w = 0.5, const int strands = STRAND_FORWARD) {
   /**
    * Parameters
    */
-  int n = fasta.size();
-  int t = fasta[0].size();
   int k = alpha.n_cols;
-  int m = t - k + 1;
-  
-  /**
-   * Posteriori
-   */
-  arma::vec z(m);
   
   /**
    * Model to reestimate
@@ -115,50 +94,39 @@ arma::mat logzoops(const std::vector<std::string> &fasta, arma::mat alpha, const
   arma::mat new_alpha(4, k);
   double new_w = 0.0;
   
+  /**
+   * Background log-probabilities, fixed during EM
+   */
+  const Background bg = backgroundPrefixes(fasta, beta);
+  arma::mat alphalog(4, k);
+  
+  /**
+   * Accumulators of each chunk of sequences
+   */
+  EMWorkspace ws = createWorkspace(fasta, k, strands);
+  
   /**
    * Convergence control
    */
   std::vector<double> convergence;
   std::vector<double> changes;
+  convergence.reserve(niter + 2);
+  changes.reserve(niter + 2);
   convergence.push_back(-std::numeric_limits<double>::infinity());
   changes.push_back(0);
   
   while (true) {
     
+    /**
+     * E-STEP and M-STEP counts, parallel across sequences
+     */
     new_alpha.fill(1e-100);
     new_w = 0.0;
-    for (const auto &seq : fasta) { // Foreach sequence
-      
-      /**
-       * E-STEP
-       */
-      
-      std::atomic<double> marginal_prob_atomic(0.0);
-      tbb::parallel_for(0, m, 1, [&](int j) {
-        const auto &kmer = seq.substr(j, k);
-        z[j] = std::log(w) + probSeqGivenPosLog(seq, alpha, beta, j);
-        
-        // Utiliza operações atômicas para atualizar marginal_prob
-        double local_z_exp = std::exp(z[j]);
-        double current_value = marginal_prob_atomic.load(std::memory_order_relaxed);
-        while (!marginal_prob_atomic.compare_exchange_weak(current_value, current_value + local_z_exp, std::memory_order_relaxed));
-      });
-      
-      double marginal_prob = marginal_prob_atomic.load();
-      
-      // zoops
-      double q = std::log(m) + probSeqGivenBetaLog(seq, beta) + std::log(1-w);
-      marginal_prob += std::exp(q);
-      /**
-       * M-STEP
-       */
-      z = arma::exp(z - std::log(marginal_prob));
-      new_w += arma::accu(z);
-      update(new_alpha, seq, z.t());
-    }
-    double sumcol = arma::accu(new_alpha.col(0));
-    alpha = new_alpha / sumcol;
-    w = new_w / n;
+    logModel(alpha, alphalog);
+    estep(fasta, bg, alphalog, w, true, true, ws, new_alpha, new_w);
+    
+    normalizeModel(new_alpha, alpha);
+    w = new_w / ws.order.size();
     
     /**
      * Convergence control
@@ -5,6 +5,7 @@
 #include <tbb/parallel_for.h>
 #include <tbb/tbb.h>
 #include <atomic>
+#include "utils.h"
 
-arma::mat logzoops(const std::vector<std::string> &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w);
-arma::mat zoops(const std::vector<std::string> &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w);
+arma::mat logzoops(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w, const int strands);
+arma::mat zoops(const EncodedFasta &fasta, arma::mat alpha, const arma::mat &beta, const double cutoff, int niter, double w, const int strands);
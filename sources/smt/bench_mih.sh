@@ -0,0 +1,24 @@
+#!/bin/bash
+
+# Benchmark of the multi-index hash backend against the SMT trie traversal.
+# Run it from an empty directory with smt, hmap, kdive and hsib in the PATH.
+# Output: dataset d backend seconds
+
+script_dir=$(cd "$(dirname "$0")" && pwd)
+source "$script_dir/../bench_common.sh"
+n=${N:-100}
+
+echo -e "dataset\td\tbackend\tseconds"
+for fasta in $(fastas); do
+    name=$(basename $fasta .fasta)
+    prepare $fasta $n
+
+    for d in 1 2 3 4; do
+        rm -f smt_data/hmap.mih
+        echo -e "$name\t$d\tkdive-smt\t$(elapsed kdive -kmers smt_data/kmers.txt -d $d)"
+        echo -e "$name\t$d\tkdive-mih-build\t$(elapsed kdive -kmers smt_data/kmers.txt -d $d -backend mih)"
+        echo -e "$name\t$d\tkdive-mih\t$(elapsed kdive -kmers smt_data/kmers.txt -d $d -backend mih)"
+        echo -e "$name\t$d\thsib-auto\t$(elapsed hsib -kmers smt_data/kmers.txt -d $d)"
+        echo -e "$name\t$d\thsib-mih\t$(elapsed hsib -kmers smt_data/kmers.txt -d $d -backend mih)"
+    done
+done
@@ -0,0 +1,24 @@
+#!/bin/bash
+
+# Scaling benchmark of kdive and khmap from 1 to N cores on the SYN datasets.
+# Run it from an empty directory with smt, hmap, kdive and khmap in the PATH.
+# Output: dataset tool threads seconds
+
+script_dir=$(cd "$(dirname "$0")" && pwd)
+source "$script_dir/../bench_common.sh"
+n=${N:-100}
+d=${D:-2}
+depth=${DEPTH:-2}
+maxthreads=${MAXTHREADS:-$(nproc)}
+
+echo -e "dataset\ttool\tthreads\tseconds"
+for fasta in $(fastas); do
+    name=$(basename $fasta .fasta)
+    prepare $fasta $n
+
+    threads=$( (for ((t = 1; t < maxthreads; t *= 2)); do echo $t; done; echo $maxthreads) | sort -nu)
+    for t in $threads; do
+        echo -e "$name\tkdive\t$t\t$(elapsed kdive -kmers smt_data/kmers.txt -d $d -depth $depth -t $t)"
+        echo -e "$name\tkhmap\t$t\t$(elapsed khmap -k $((k - 2)) -depth $((depth + 1)) -t $t)"
+    done
+done
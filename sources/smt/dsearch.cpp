@@ -36,14 +36,15 @@ int main(int argc, char **argv) {
     std::vector<std::string> fasta = readFasta(path);
     std::vector<std::string> kmers = readkmers(path2kmers);
 
-    std::map<std::string, std::map<std::string, int>> hmap = busca_direta(fasta, kmers, d);
+    std::map<uint64_t, std::map<uint64_t, int>> hmap = busca_direta(fasta, kmers, d);
+    const int k = kmers[0].size();
 
     int ret = std::system("rm -Rf smt_data/dsearch_dir");
     ret = std::system("mkdir -p smt_data/dsearch_dir");
     for (const auto &kmer : hmap) {
-        std::ofstream f("smt_data/dsearch_dir/" + kmer.first + ".txt");    
+        std::ofstream f("smt_data/dsearch_dir/" + index2kmer(kmer.first, k) + ".txt");    
         for (const auto &km : kmer.second) {
-            f << km.first << " " << km.second << std::endl;
+            f << index2kmer(km.first, k) << " " << km.second << std::endl;
         }
         f.close();
     }
@@ -1,59 +1,103 @@
 #include "hmap.h"
 #include "smt_utils.h"
 
-extern std::vector<std::string> fasta;
-std::ifstream smtdb("smt_data/SMT.db", std::ios::binary);
-tbb::concurrent_unordered_map<std::string, uint64_t> final_hash;
-std::mutex mtx;
-std::atomic_bool still_processing(true);
-tbb::concurrent_queue<tbb::concurrent_unordered_map<std::string, uint64_t>> maps;
 #define mem_reserv 10000
 
-void consumer() {
-  while (!maps.empty() || still_processing.load()) {
-      tbb::concurrent_unordered_map<std::string, uint64_t> map;
-      map.reserve(mem_reserv);
-      while (maps.try_pop(map)) {
-          for(auto& kv : map) {
-              final_hash[kv.first] += kv.second;
-          }
+// Partial count table of a range of SMT batches. Partial tables are only moved
+// and joined pairwise, so the merge is a tree over the TBB workers.
+struct HmapReducer {
+  std::ifstream &smtdb;
+  std::mutex &mtx;
+  std::unordered_map<uint64_t, uint64_t> hash;
+  
+  HmapReducer(std::ifstream &smtdb, std::mutex &mtx) : smtdb(smtdb), mtx(mtx) {
+    hash.reserve(mem_reserv);
+  }
+  
+  HmapReducer(HmapReducer &other, tbb::split) : smtdb(other.smtdb), mtx(other.mtx) {
+    hash.reserve(mem_reserv);
+  }
+  
+  void operator()(const tbb::blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i < r.end(); ++i) {
+      
+      // Load batch, SMT.db is a sequential stream
+      arma::SpMat<uint64_t> S;
+      {std::unique_lock lock(mtx); S.load(smtdb, arma::arma_binary);}
+      
+      // Processing
+      arma::Col<uint64_t> counts{ S.col(4) };
+      arma::Col<uint64_t> kmers { S.col(5) };
+      arma::uvec nonZeroIndices { arma::find(counts > 0) };
+      
+      for (size_t j {0}; j < nonZeroIndices.n_elem; ++j) {
+        hash[kmers[nonZeroIndices[j]]] += counts[nonZeroIndices[j]];
       }
+    }
   }
-}
+  
+  void join(HmapReducer &rhs) {
+    if (hash.size() < rhs.hash.size()) hash.swap(rhs.hash);
+    for (const auto &kv : rhs.hash) hash[kv.first] += kv.second;
+    rhs.hash = std::unordered_map<uint64_t, uint64_t>();
+  }
+};
 
 //'Compute fast hashmap from smt_data.
-//'@name fast_hash
-//'@param path Path to smt_data.
-//'@param nthreads Number of threads.
-//'@return C++ String Hash Map.
-void hmap(int nb, int k) {
-
-  tbb::parallel_for(tbb::blocked_range<size_t>(0, nb), [&] (const auto &r) {
-    tbb::concurrent_unordered_map<std::string, uint64_t> hash;
-    hash.reserve(mem_reserv);
-
-    for (size_t i = r.begin(); i < r.end(); ++i) {
+//'@name hmap
+//'@param nb Number of batches in smt_data/SMT.db.
+//'@return Hash map of kmer indexes and counts.
+std::unordered_map<uint64_t, uint64_t> hmap(int nb) {
+  
+  std::ifstream smtdb("smt_data/SMT.db", std::ios::binary);
+  std::mutex mtx;
+  
+  HmapReducer reducer(smtdb, mtx);
+  tbb::parallel_reduce(tbb::blocked_range<size_t>(0, nb), reducer);
+  
+  return std::move(reducer.hash);
+}
 
-      // Load file
-      auto *S { new arma::SpMat<uint64_t>() };
-      {std::unique_lock lock(mtx); S->load(smtdb, arma::arma_binary);}
 
-      // Processing
-      arma::Col<uint64_t> counts{ S->col(4) };
-      arma::Col<uint64_t> kmers { S->col(5) };
-      delete S;
-      arma::uvec nonZeroIndices { arma::find(counts > 0) };
-      counts = counts(nonZeroIndices);
-      kmers = kmers(nonZeroIndices);
+//'Compare kmers by count, ties broken by kmer index.
+//'@name more_frequent
+//'@param a Pair (kmer index, count).
+//'@param b Pair (kmer index, count).
+//'@return True if a comes before b in the ranking.
+static inline bool more_frequent(const std::pair<uint64_t, uint64_t> &a, const std::pair<uint64_t, uint64_t> &b) {
+  return a.second > b.second || (a.second == b.second && a.first < b.first);
+}
 
-      for (size_t i {0}; i < nonZeroIndices.n_elem; ++i) {
-        std::string kmer { index2kmer(kmers[i], k) };
-        hash[kmer] += counts[i];
+//'Select the n most frequent kmers with one bounded heap per thread.
+//'@name topn
+//'@param table Pairs (kmer index, count).
+//'@param n Number of kmers to select.
+//'@return The n best pairs, most frequent first.
+std::vector<std::pair<uint64_t, uint64_t>> topn(const std::vector<std::pair<uint64_t, uint64_t>> &table, const size_t n) {
+  
+  // The heap front is the worst kmer kept by the thread
+  tbb::enumerable_thread_specific<std::vector<std::pair<uint64_t, uint64_t>>> heaps;
+  
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, table.size()), [&] (const auto &r) {
+    auto &heap = heaps.local();
+    for (size_t i = r.begin(); i < r.end(); ++i) {
+      if (heap.size() < n) {
+        heap.push_back(table[i]);
+        std::push_heap(heap.begin(), heap.end(), more_frequent);
+      }
+      else if (n > 0 && more_frequent(table[i], heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), more_frequent);
+        heap.back() = table[i];
+        std::push_heap(heap.begin(), heap.end(), more_frequent);
       }
     }
-    maps.push(hash);
   });
-
-  still_processing.store(false);
-
+  
+  // Merge heaps
+  std::vector<std::pair<uint64_t, uint64_t>> best;
+  for (const auto &heap : heaps) best.insert(best.end(), heap.begin(), heap.end());
+  std::sort(best.begin(), best.end(), more_frequent);
+  if (best.size() > n) best.resize(n);
+  
+  return best;
 }
\ No newline at end of file
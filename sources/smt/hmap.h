@@ -3,15 +3,13 @@
 #include <armadillo>
 #include<iostream>
 #include<fstream>
-#include <tbb/concurrent_hash_map.h>
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 #include <tbb/tbb.h>
 #include <vector>
-#include <thread>
+#include <algorithm>
+#include <unordered_map>
 #include <mutex>
-#include <condition_variable>
-#include <atomic>
-#include <future>
 
-void hmap(int nb, int k);
-void consumer();
\ No newline at end of file
+std::unordered_map<uint64_t, uint64_t> hmap(int nb);
+std::vector<std::pair<uint64_t, uint64_t>> topn(const std::vector<std::pair<uint64_t, uint64_t>> &table, const size_t n);
@@ -11,10 +11,11 @@ int main(int argc, char* argv[]) {
   
   int d = 0;
   std::string path2kmers = "";
+  std::string backend = "auto";
   
   // Verificar se há número suficiente de argumentos
   if (argc < 5) {
-    std::cerr << "Uso: hsib -kmers <kmers.txt> -d <number of mutations> < <hmap file>\n";
+    std::cerr << "Uso: hsib -kmers <kmers.txt> -d <number of mutations> [-backend <auto or mih>]\n";
     return 1;
   }
   
@@ -30,20 +31,38 @@ int main(int argc, char* argv[]) {
       path2kmers = argv[i + 1];
     }
     
+    else if (arg == "-backend") {
+      backend = argv[i + 1];
+    }
+    
     else {
       std::cerr << "Argumento desconhecido: " << arg << "\n";
       return 1;
     }
   }
   
-  // Read map
-  tbb::concurrent_hash_map <std::string, uint64_t> hmap;
-  std::string kmer;
-  uint64_t count;
-  while (std::cin >> kmer >> count) hmap.emplace(kmer, count);
-  
   // Read kmers
   std::vector<std::string> kmers = readkmers(path2kmers);
+  if (kmers.empty()) return 0;
+  const int k = kmers[0].size();
+  
+  // Open binary hmap
+  HmapView hmap;
+  if (!openHmap(hmap, "smt_data/hmap.bin")) {
+    std::cerr << "Não foi possível abrir smt_data/hmap.bin\n";
+    return 1;
+  }
+  
+  // Multi-index backend: reuse smt_data/hmap.mih when it is still valid
+  if (backend == "mih") {
+    MultiIndex index;
+    if (!loadMIH(index, "smt_data/hmap.mih") || !isMIHValid(index, hmap, k, d)) {
+      index = buildMIH(hmap, k, d);
+      saveMIH(index, "smt_data/hmap.mih");
+    }
+    hsib(index, kmers, d);
+    return 0;
+  }
   
   // Call the hash function with the parsed arguments
   hsib(hmap, kmers, d);
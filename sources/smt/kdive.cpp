@@ -1,5 +1,6 @@
 #include <armadillo>
 #include "smt_operations.h"
+#include "smt_utils.h"
 #include <iostream>
 #include <string>
 #include <cstdlib>
@@ -9,11 +10,14 @@
 int main(int argc, char* argv[]) {
   
   int d = 0;
+  int depth = 2;
+  int nthreads = tbb::this_task_arena::max_concurrency();
   std::string path2kmers = "";
+  std::string backend = "smt";
   
   // Verificar se há número suficiente de argumentos
   if (argc < 5) {
-    std::cerr << "Uso: kdive -kmers <path to kmers> -d <number of mutations>\n";
+    std::cerr << "Uso: kdive -kmers <path to kmers> -d <number of mutations> [-depth <task depth>] [-t <number of threads>] [-backend <smt or mih>]\n";
     return 1;
   }
   
@@ -29,6 +33,18 @@ int main(int argc, char* argv[]) {
       path2kmers = argv[i + 1];
     }
     
+    else if (arg == "-depth") {
+      depth = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-t") {
+      nthreads = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-backend") {
+      backend = argv[i + 1];
+    }
+    
     else {
       std::cerr << "Argumento desconhecido: " << arg << "\n";
       return 1;
@@ -48,26 +64,50 @@ int main(int argc, char* argv[]) {
     std::cerr << "Não foi possível abrir o arquivo!" << std::endl;
   }
   
+  // Read kmer size
+  std::ifstream meta("smt_data/meta.txt");
+  std::string temp;
+  int k;
+  meta >> temp >> k;
+  meta.close();
+  
   // Call the hash function with the parsed arguments
-  const auto &hmap = kdive(kmers, d);
+  tbb::global_control control(tbb::global_control::max_allowed_parallelism, nthreads);
+  std::vector<std::unordered_map<uint64_t, uint64_t>> hmap;
+  
+  if (backend == "mih") {
+    HmapView view;
+    if (!openHmap(view, "smt_data/hmap.bin")) {
+      std::cerr << "Não foi possível abrir smt_data/hmap.bin\n";
+      return 1;
+    }
+    
+    MultiIndex index;
+    if (!loadMIH(index, "smt_data/hmap.mih") || !isMIHValid(index, view, k, d)) {
+      index = buildMIH(view, k, d);
+      saveMIH(index, "smt_data/hmap.mih");
+    }
+    hmap = kdive(index, kmers, d);
+  }
+  
+  else {
+    hmap = kdive(kmers, d, depth);
+  }
   
   // Criando diretório de saída
   int ret = system("rm -Rf smt_data/kdive_dir");
   mkdir("smt_data/kdive_dir", 0777);
   
-  // Iterando pelo concurrent_hash_map externo
-  //for (auto it = hmap.begin(); it != hmap.end(); ++it) {
-  tbb::parallel_for_each(hmap.begin(), hmap.end(), [&](const auto& it) {
-    const auto &kmer = it.first;
-    const auto &map = it.second;
+  // Iterando pelos kmers
+  tbb::parallel_for(size_t(0), hmap.size(), [&](size_t s) {
+    const auto &kmer = kmers[s];
+    const auto &map = hmap[s];
+    if (map.empty()) return;
     std::ofstream fdive("smt_data/kdive_dir/" + kmer + ".txt");
     
-    // Iterando pelo concurrent_hash_map interno
-    for (auto inner_it = map.begin(); inner_it != map.end(); ++inner_it) {
-    //tbb::parallel_for_each(map.begin(), map.end(), [&](const auto& inner_it) {
-      const auto &sibling = inner_it->first;
-      const auto &counts = inner_it->second;
-      fdive << sibling << ' ' << counts << std::endl;
+    // Iterando pelos irmãos
+    for (const auto &sibling : map) {
+      fdive << index2kmer(sibling.first, k) << ' ' << sibling.second << std::endl;
     }
     
     fdive.close();
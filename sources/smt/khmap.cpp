@@ -1,5 +1,6 @@
 #include <armadillo>
 #include "smt_operations.h"
+#include "smt_utils.h"
 #include <iostream>
 #include <string>
 #include <cstdlib>
@@ -10,10 +11,12 @@
 int main(int argc, char* argv[]) {
   
   int k = 0;
+  int depth = 3;
+  int nthreads = tbb::this_task_arena::max_concurrency();
   
   // Verificar se há número suficiente de argumentos
   if (argc < 3) {
-    std::cerr << "Uso: khmap -k <size of kmer>\n";
+    std::cerr << "Uso: khmap -k <size of kmer> [-depth <task depth>] [-t <number of threads>]\n";
     return 1;
   }
   
@@ -26,6 +29,14 @@ int main(int argc, char* argv[]) {
       k = std::stoi(argv[i + 1]);
     }
     
+    else if (arg == "-depth") {
+      depth = std::stoi(argv[i + 1]);
+    }
+    
+    else if (arg == "-t") {
+      nthreads = std::stoi(argv[i + 1]);
+    }
+    
     else {
       std::cerr << "Invalid argument: " << arg << "\n";
       return 1;
@@ -33,11 +44,12 @@ int main(int argc, char* argv[]) {
   }
   
   // Chamar a função de hash com os argumentos analisados
-  tbb::concurrent_hash_map<std::string, uint64_t> hmap { khmap(k) };
+  tbb::global_control control(tbb::global_control::max_allowed_parallelism, nthreads);
+  std::unordered_map<uint64_t, uint64_t> hmap { khmap(k, depth) };
   
   // Imprimir o vetor ordenado
   for (const auto &pair : hmap) {
-    std::cout << pair.first << " " << pair.second << '\n';
+    std::cout << index2kmer(pair.first, k) << " " << pair.second << '\n';
   }
   
   return 0;
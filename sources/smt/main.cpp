@@ -8,10 +8,6 @@ int main(int argc, char **argv) {
     int choice { std::stoi(argv[3]) };
 
     int k { 30 };
-    const int n = len - 0;
-    const int t = fasta[0].size();
-    const int m = t - k + 1;
-    uint64_t nr = m * n * k;
 
 
     if (choice == 1) {
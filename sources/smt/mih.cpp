@@ -0,0 +1,199 @@
+#include "mih.h"
+#include "smt_utils.h"
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+//'Value of a segment of a kmer index.
+//'@name segment_value.
+//'@param code Kmer index with 2 bits per symbol.
+//'@param k Size of kmer.
+//'@param start First symbol of the segment.
+//'@param len Number of symbols of the segment.
+//'@return Index of the segment symbols.
+static inline uint64_t segment_value(uint64_t code, int k, int start, int len) {
+  uint64_t mask = (len == 32) ? ~0ULL : ((1ULL << (2 * len)) - 1);
+  return (code >> (2 * (k - start - len))) & mask;
+}
+
+//'Hash of the kmer indexes and counts of a hmap, the fingerprint of the table a
+//'multi-index was built from.
+//'@name hmapHash.
+//'@param codes Kmer indexes of the hmap.
+//'@param counts Counts of each kmer in codes.
+//'@param n Number of kmers.
+//'@return 64 bits FNV-1a of the 2n words.
+uint64_t hmapHash(const uint64_t *codes, const uint64_t *counts, const size_t n) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < n; ++i) {
+    hash = (hash ^ codes[i]) * 0x100000001b3ULL;
+    hash = (hash ^ counts[i]) * 0x100000001b3ULL;
+  }
+  return hash ^ (hash >> 32);
+}
+
+//'Build the multi-index hash of kmer indexes for searches with up to d mutations.
+//'@name buildMIH.
+//'@param hmap Open view of the hmap.bin, its fingerprint is kept in the index.
+//'@param k Size of kmers.
+//'@param d Max number of mutations of the searches.
+//'@return The multi-index with d+1 segments.
+MultiIndex buildMIH(const HmapView &hmap, const int k, const int d) {
+  const uint64_t *codes = hmap.codes;
+  const size_t n = hmap.n;
+
+  MultiIndex index;
+  index.k = k;
+  index.d = std::min(d, k - 1);
+  index.payload = hmap.payload;
+  index.hash = hmapHash(hmap.codes, hmap.counts, n);
+  index.codes.assign(codes, codes + n);
+  index.counts.assign(hmap.counts, hmap.counts + n);
+
+  const int nseg = index.d + 1;
+  index.segments.resize(nseg);
+
+  tbb::parallel_for(0, nseg, [&](int s) {
+    MIHSegment &seg = index.segments[s];
+    seg.start = s * k / nseg;
+    seg.len = (s + 1) * k / nseg - seg.start;
+    seg.blen = std::min(seg.len, MIH_MAX_BUCKET_SYMBOLS);
+
+    // Sort ids by segment value
+    std::vector<std::pair<uint64_t, uint32_t>> keys(n);
+    for (uint32_t i = 0; i < n; ++i) keys[i] = {segment_value(codes[i], k, seg.start, seg.len), i};
+    tbb::parallel_sort(keys.begin(), keys.end());
+
+    seg.ids.resize(n);
+    seg.offsets.assign((1ULL << (2 * seg.blen)) + 1, 0);
+    for (uint32_t i = 0; i < n; ++i) {
+      seg.ids[i] = keys[i].second;
+      seg.offsets[(keys[i].first >> (2 * (seg.len - seg.blen))) + 1] += 1;
+    }
+    for (size_t b = 1; b < seg.offsets.size(); ++b) seg.offsets[b] += seg.offsets[b - 1];
+  });
+
+  return index;
+}
+
+//'Search all kmers with up to d mutations from code.
+//'@name searchMIH.
+//'@param index Multi-index hash.
+//'@param code Kmer index to search siblings.
+//'@param d Number of mutations allowed. Must not be greater than index.d.
+//'@param hits Ids of the siblings in index.codes.
+void searchMIH(const MultiIndex &index, const uint64_t code, const int d, std::vector<uint32_t> &hits) {
+  const int k = index.k;
+  const auto &codes = index.codes;
+  const auto &segments = index.segments;
+  hits.clear();
+
+  for (size_t s = 0; s < segments.size(); ++s) {
+    const MIHSegment &seg = segments[s];
+    const uint64_t key = segment_value(code, k, seg.start, seg.len);
+    const uint64_t bucket = key >> (2 * (seg.len - seg.blen));
+    auto first = seg.ids.begin() + seg.offsets[bucket];
+    auto last = seg.ids.begin() + seg.offsets[bucket + 1];
+
+    // Remaining symbols of the segment are sorted inside the bucket
+    if (seg.len > seg.blen) {
+      first = std::partition_point(first, last, [&](uint32_t id) { return segment_value(codes[id], k, seg.start, seg.len) < key; });
+      last = std::partition_point(first, last, [&](uint32_t id) { return segment_value(codes[id], k, seg.start, seg.len) == key; });
+    }
+
+    for (auto it = first; it != last; ++it) {
+      const uint64_t candidate = codes[*it];
+      if (hDist2bit(candidate, code) > d) continue;
+
+      // Report each sibling only from the first segment it matches
+      bool seen = false;
+      for (size_t p = 0; p < s && !seen; ++p) {
+        const MIHSegment &prev = segments[p];
+        seen = segment_value(candidate, k, prev.start, prev.len) == segment_value(code, k, prev.start, prev.len);
+      }
+      if (!seen) hits.push_back(*it);
+    }
+  }
+}
+
+//'Save the multi-index hash in binary format.
+//'@name saveMIH.
+//'@param index Multi-index hash.
+//'@param path Output file, usually smt_data/hmap.mih.
+//'@return True if the file was written.
+bool saveMIH(const MultiIndex &index, const std::string &path) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) return false;
+
+  const uint64_t n = index.codes.size();
+  const uint32_t header[4] = {MIH_MAGIC, MIH_VERSION, uint32_t(index.k), uint32_t(index.d)};
+  const uint64_t fingerprint[3] = {n, index.payload, index.hash};
+  file.write(reinterpret_cast<const char*>(header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(fingerprint), sizeof(fingerprint));
+  file.write(reinterpret_cast<const char*>(index.codes.data()), n * sizeof(uint64_t));
+  file.write(reinterpret_cast<const char*>(index.counts.data()), n * sizeof(uint64_t));
+
+  for (const auto &seg : index.segments) {
+    const int32_t geometry[3] = {seg.start, seg.len, seg.blen};
+    file.write(reinterpret_cast<const char*>(geometry), sizeof(geometry));
+    file.write(reinterpret_cast<const char*>(seg.offsets.data()), seg.offsets.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(seg.ids.data()), n * sizeof(uint32_t));
+  }
+
+  return file.good();
+}
+
+//'Load the multi-index hash saved by saveMIH.
+//'@name loadMIH.
+//'@param index Multi-index hash to fill.
+//'@param path Input file, usually smt_data/hmap.mih.
+//'@return True if the file was read.
+bool loadMIH(MultiIndex &index, const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) return false;
+
+  uint32_t header[4];
+  uint64_t fingerprint[3];
+  file.read(reinterpret_cast<char*>(header), sizeof(header));
+  file.read(reinterpret_cast<char*>(fingerprint), sizeof(fingerprint));
+  if (!file || header[0] != MIH_MAGIC || header[1] != MIH_VERSION) return false;
+
+  const uint64_t n = fingerprint[0];
+  index.k = header[2];
+  index.d = header[3];
+  index.payload = fingerprint[1];
+  index.hash = fingerprint[2];
+  index.codes.resize(n);
+  index.counts.resize(n);
+  file.read(reinterpret_cast<char*>(index.codes.data()), n * sizeof(uint64_t));
+  file.read(reinterpret_cast<char*>(index.counts.data()), n * sizeof(uint64_t));
+
+  index.segments.resize(index.d + 1);
+  for (auto &seg : index.segments) {
+    int32_t geometry[3];
+    file.read(reinterpret_cast<char*>(geometry), sizeof(geometry));
+    seg.start = geometry[0];
+    seg.len = geometry[1];
+    seg.blen = geometry[2];
+    seg.offsets.resize((1ULL << (2 * seg.blen)) + 1);
+    seg.ids.resize(n);
+    file.read(reinterpret_cast<char*>(seg.offsets.data()), seg.offsets.size() * sizeof(uint32_t));
+    file.read(reinterpret_cast<char*>(seg.ids.data()), n * sizeof(uint32_t));
+  }
+
+  return file.good();
+}
+
+//'Check if a saved multi-index can answer searches for k and d and was built from the
+//'current hmap. The size, payload and hash of the source table are compared with the
+//'fingerprint saved in the index, so a rewritten hmap.bin is detected whatever its mtime.
+//'@name isMIHValid.
+//'@param index Multi-index hash loaded from smt_data/hmap.mih.
+//'@param source Open view of the hmap the index must match, usually smt_data/hmap.bin.
+//'@param k Size of kmers.
+//'@param d Number of mutations of the searches.
+//'@return True if the index can be reused.
+bool isMIHValid(const MultiIndex &index, const HmapView &source, const int k, const int d) {
+  if (index.k != k || index.d < std::min(d, k - 1)) return false;
+  if (index.codes.size() != source.n || index.payload != source.payload) return false;
+  return index.hash == hmapHash(source.codes, source.counts, source.n);
+}
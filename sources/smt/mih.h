@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+#include "hmap_io.h"
+
+#define MIH_MAX_BUCKET_SYMBOLS 10
+#define MIH_MAGIC 0x4849424d     // "MBIH"
+#define MIH_VERSION 2
+
+// Multi-index hash over the kmer indexes of the hmap. The kmer is split into
+// d+1 segments; any kmer with up to d mutations matches at least one segment
+// exactly, so each segment is looked up in its own table and the candidates are
+// verified with hDist2bit.
+struct MIHSegment {
+  int start;                       // First symbol of the segment in the kmer
+  int len;                         // Number of symbols in the segment
+  int blen;                        // Number of leading symbols used as bucket
+  std::vector<uint32_t> offsets;   // Bucket offsets into ids, size 4^blen + 1
+  std::vector<uint32_t> ids;       // Kmer ids sorted by segment value
+};
+
+struct MultiIndex {
+  int k = 0;
+  int d = 0;
+  uint64_t payload = 0;            // Payload bytes of the hmap.bin the index was built from
+  uint64_t hash = 0;               // Hash of the codes and counts of that hmap.bin
+  std::vector<uint64_t> codes;
+  std::vector<uint64_t> counts;
+  std::vector<MIHSegment> segments;
+};
+
+uint64_t hmapHash(const uint64_t *codes, const uint64_t *counts, const size_t n);
+MultiIndex buildMIH(const HmapView &hmap, const int k, const int d);
+bool saveMIH(const MultiIndex &index, const std::string &path);
+bool loadMIH(MultiIndex &index, const std::string &path);
+bool isMIHValid(const MultiIndex &index, const HmapView &source, const int k, const int d);
+void searchMIH(const MultiIndex &index, const uint64_t code, const int d, std::vector<uint32_t> &hits);
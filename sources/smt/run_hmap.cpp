@@ -1,19 +1,64 @@
 #include "hmap.h"
+#include "hmap_io.h"
+#include "smt_utils.h"
 #include <iostream>
 #include <string>
 #include <cstdlib>
 #include <sqlite3.h>
-
-extern tbb::concurrent_unordered_map<std::string, uint64_t> final_hash;
+#include <tbb/parallel_sort.h>
 
 int main(int argc, char* argv[]) {
 
   int top = 0;
+  bool compress = false;
+  bool text = false;
+  bool table_out = true;
+
+  // Iterar através dos argumentos da linha de comando
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
 
-  // Verificar se há número suficiente de argumentos
-  if (argc < 1) {
-    std::cerr << "Uso: hmap\n";
-    return 1;
+    if (arg == "--text") {
+      text = true;
+    }
+
+    else if (arg == "-c" && i + 1 < argc) {
+      compress = std::stoi(argv[++i]) != 0;
+    }
+
+    else if (arg == "-n" && i + 1 < argc) {
+      top = std::stoi(argv[++i]);
+    }
+
+    else if (arg == "-table" && i + 1 < argc) {
+      table_out = std::stoi(argv[++i]) != 0;
+    }
+
+    else {
+      std::cerr << "Uso: hmap [-n <top kmers>] [-table <0 or 1>] [-c <0 or 1 compression>] [--text]\n";
+      return 1;
+    }
+  }
+
+  // Export the binary table as KMER COUNT lines
+  if (text) {
+    HmapView view;
+    if (!openHmap(view, "smt_data/hmap.bin")) {
+      std::cerr << "Não foi possível abrir smt_data/hmap.bin\n";
+      return 1;
+    }
+
+    std::ostringstream buffer;
+    for (uint64_t i = 0; i < view.n; ++i) {
+      buffer << index2kmer(view.codes[i], view.k) << ' ' << view.counts[i] << '\n';
+      if (buffer.tellp() >= 16384) {
+        std::cout << buffer.str();
+        buffer.str("");
+      }
+    }
+    std::cout << buffer.str();
+
+    return 0;
   }
 
 
@@ -25,39 +70,35 @@ int main(int argc, char* argv[]) {
   meta >> str >> nb;
   meta.close();
 
-  hmap(nb, k);
-  std::thread c1(consumer);
-  std::thread c2(consumer);
-  std::thread c3(consumer);
-
-  c1.join();
-  c2.join();
-  c3.join();
+  std::vector<std::pair<uint64_t, uint64_t>> table;
+  {
+    std::unordered_map<uint64_t, uint64_t> hash { hmap(nb) };
+    table.assign(hash.begin(), hash.end());
+  }
   
+  // Saving the n most frequent kmers in smt_data/kmers.txt
+  if (top > 0) {
+    std::ofstream fkmers("smt_data/kmers.txt");
+    for (const auto &kv : topn(table, top)) fkmers << index2kmer(kv.first, k) << '\n';
+    fkmers.close();
+  }
   
-  // Saving hash in file
-  std::mutex mtx;
-  std::ofstream outfile("smt_data/hmap.txt");
-  tbb::parallel_for(final_hash.range(), [&](auto &range)  {
-    std::ostringstream buffer;
-    for (auto it { range.begin() }; it != range.end(); ++it) {
-      buffer << it->first << " " << it->second << std::endl;
-
-      if (buffer.tellp() >= 16384) {
-        std::unique_lock<std::mutex> lock(mtx);
-        outfile << buffer.str();
-        buffer.str("");
-        buffer.clear();
-      }
+  // Saving hash in binary file, sorted by kmer index
+  if (table_out) {
+    tbb::parallel_sort(table.begin(), table.end());
+    
+    std::vector<uint64_t> codes(table.size());
+    std::vector<uint64_t> counts(table.size());
+    tbb::parallel_for(size_t(0), table.size(), [&](size_t j) {
+      codes[j] = table[j].first;
+      counts[j] = table[j].second;
+    });
+    
+    if (!writeHmap("smt_data/hmap.bin", k, codes, counts, compress)) {
+      std::cerr << "Não foi possível escrever smt_data/hmap.bin\n";
+      return 1;
     }
-
-    if (!buffer.str().empty()) {
-      std::unique_lock<std::mutex> lock(mtx);
-      outfile << buffer.str();
-    }
-  });
-
-  outfile.close();
+  }
 
   return 0;
 }
@@ -12,10 +12,11 @@ int main(int argc, char* argv[]) {
   std::string fastaPath;
   int k = 0;
   int s = 256;
+  size_t tile = 0;
   
   // Verificar se há número suficiente de argumentos
   if (argc < 7) {
-    std::cerr << "Use: smt -i <fasta path> -k <size of kmer> -s <priori memory allocation>\n";
+    std::cerr << "Use: smt -i <fasta path> -k <size of kmer> -s <priori memory allocation> [-tile <max size of the tiles of long records>]\n";
     return 1;
   }
   
@@ -34,15 +35,20 @@ int main(int argc, char* argv[]) {
       s = std::stoi(argv[i + 1]);
     }
     
+    else if (arg == "-tile") {
+      tile = std::stoul(argv[i + 1]);
+    }
+    
     else {
       std::cerr << "Unknown argument: " << arg << "\n";
       return 1;
     }
   }
   
-  // Read fasta file
-  std::vector<std::string> fasta { readFasta(fastaPath) };
-  std::thread process(processMT, fasta, k, s);
+  // Read fasta file, genomes in tiles overlapping by k-1 so each kmer is counted once
+  std::vector<TileCoord> coords;
+  std::vector<std::string> fasta { tile > 0 ? readFastaTiles(fastaPath, tile, k - 1, coords) : readFasta(fastaPath) };
+  std::thread process(processMT, std::move(fasta), k, s);
   std::thread save(saveMT);
   process.join();
   save.join();
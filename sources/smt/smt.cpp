@@ -24,20 +24,16 @@ std::tuple<int, int> computeBatchSize(int n, int bsize) {
 //'Use TBB Concurrent HashMap to create a hash for fasta.
 //'@name createTBBhash_.
 //'@param fasta Dataset of sequences.
+//'@param order Sequence indexes grouped by length, from lengthOrder.
 //'@param hash Tbb Concurrent HashMap.
 //'@param k Size of the kmer.
-//'@param start Initial sequence in actual batch.
-//'@param end Final sequence in actual batch.
-void createTBBhash_(const std::vector<std::string> &fasta, tbb::concurrent_hash_map<std::string, uint64_t> &hash, const int k, const int start, const int end) {
-  
- const int n = end - start;
- const int t = fasta[0].size();
- const int m = t - k + 1;
- 
- uint64_t nr = m * n * k;
+//'@param start Initial position in order of actual batch.
+//'@param end Final position in order of actual batch.
+void createTBBhash_(const std::vector<std::string> &fasta, const std::vector<size_t> &order, tbb::concurrent_hash_map<std::string, uint64_t> &hash, const int k, const int start, const int end) {
  
- for (size_t i = start; i < end; ++i) {
-  const auto &seq = fasta[i];
+ for (size_t p = start; p < end; ++p) {
+  const auto &seq = fasta[order[p]];
+  const int m = seq.size() - k + 1;
   for (size_t j = 0; j < m; ++j) {
     const auto &kmer = seq.substr(j, k);
     tbb::concurrent_hash_map<std::string, uint64_t>::accessor acc;
@@ -54,14 +50,13 @@ void createTBBhash_(const std::vector<std::string> &fasta, tbb::concurrent_hash_
 //' @param bsize Size of the bacthes.
 //'@return Tbb Concurrent HashMap with kmers and yours counts with size k.
 tbb::concurrent_hash_map<std::string, uint64_t> createTBBhash(std::vector<std::string> &fasta, const int k, const int bsize) {
-  int n = fasta.size();
-  int t = fasta[0].size();
-
   tbb::concurrent_hash_map<std::string, uint64_t> hash;
   
-  // Number of batches
-  int nb, r;
-  std::tie(nb, r) = computeBatchSize(n, bsize);
+  // Batches of sequences of similar length
+  const std::vector<size_t> lengths = sequenceLengths(fasta);
+  const std::vector<size_t> order = lengthOrder(lengths, k);
+  const std::vector<size_t> bounds = lengthBatches(lengths, order, k, bsize);
+  const int nb = bounds.empty() ? 0 : bounds.size() - 1;
   
   //setupBuffer
   int ret = std::system("rm -Rf smt_data");
@@ -69,9 +64,7 @@ tbb::concurrent_hash_map<std::string, uint64_t> createTBBhash(std::vector<std::s
 
   tbb::parallel_for(tbb::blocked_range<size_t>(0, nb), [&](tbb::blocked_range<size_t> r) {
     for (size_t i = r.begin(); i != r.end(); ++i) {
-      int start = i * bsize;
-      int end = (i + 1) * bsize;
-      createTBBhash_(fasta, hash, k, start, end);
+      createTBBhash_(fasta, order, hash, k, bounds[i], bounds[i + 1]);
     }
   });
 
@@ -86,11 +79,10 @@ tbb::concurrent_hash_map<std::string, uint64_t> createTBBhash(std::vector<std::s
 //'@param end The final sequences will be processed.
 //'@return A arma::Mat<uint> with all kmers stored.
 arma::Mat<uint64_t>* createDenseMT(const std::vector<std::string> &fasta, const int k, const int start, const int end) {
- const auto n {end - start};
- const auto t { fasta[0].size() };
- const auto m { t - k + 1 };
+ // At most one node per symbol of each kmer
+ uint64_t nr {1};
+ for (auto i {start}; i < end; ++i) if (fasta[i].size() >= size_t(k)) nr += (fasta[i].size() - k + 1) * k;
  
- auto nr { m * n * k };
  auto *MT = new arma::Mat<uint64_t>(nr, 6);
  uint64_t next {0};
  uint64_t current {0};
@@ -98,6 +90,7 @@ arma::Mat<uint64_t>* createDenseMT(const std::vector<std::string> &fasta, const
  
  for (auto i {start} ; i < end; ++i) {
    auto &seq {fasta[i]};
+   const int m = seq.size() - k + 1;
    
    for (int j = 0; j < m; ++j) {
      uint64_t node {0};
@@ -143,18 +136,18 @@ arma::Mat<uint64_t>* createDenseMT(const std::vector<std::string> &fasta, const
 //'@param end The final sequences will be processed.
 //'@return A arma::Mat<uint> with all kmers stored.
 uint64_t* createDenseMT2(const std::vector<std::string> &fasta, const int k, const int start, const int end) {
- const auto n {end - start};
- const auto t {fasta[0].size()};
- const auto m  {t - k + 1};
+ // At most one node per symbol of each kmer
+ uint64_t nr {1};
+ for (auto i {start}; i < end; ++i) if (fasta[i].size() >= size_t(k)) nr += (fasta[i].size() - k + 1) * k;
  
- auto nr { m * n * k};
- auto *MT {new uint64_t [nr * 6]};
+ auto *MT {new uint64_t [nr * 6]()};
  auto next {0};
  auto current {0};
  auto symbol {0};
  
  for (auto i {start}; i < end; ++i) {
    const auto &seq {fasta[i]};
+   const int m = seq.size() - k + 1;
    
    for (auto j {0}; j < m; ++j) {
      uint64_t node = 0;
@@ -212,15 +205,21 @@ void saveMT() {
   wrt.notify_one();
 }
 
-//'Creates SMT matrix from the sequences.
+//'Creates SMT matrix from the sequences. Sequences are grouped by length so each
+//'batch holds about the same number of kmers.
 //'@name createSparseMT.
-//'@param fasta The Dataset of sequences.
+//'@param fasta The Dataset of sequences, reordered by length bucket.
 //'@param k The Size of kmers.
-void processMT(const std::vector<std::string> &fasta, const int k, const int bsize) {
+//'@param bsize Max number of sequences of a batch.
+void processMT(std::vector<std::string> fasta, const int k, const int bsize) {
  
-  const auto n { fasta.size() };
-  const auto t { fasta[0].size() };
-  const auto m { t - k + 1 };
+  // Kmer counts do not depend on the order, sequences shorter than k are dropped
+  const std::vector<size_t> lengths { sequenceLengths(fasta) };
+  const std::vector<size_t> order { lengthOrder(lengths, k) };
+  const std::vector<size_t> bounds { lengthBatches(lengths, order, k, bsize) };
+  std::vector<std::string> sorted(order.size());
+  for (size_t p = 0; p < order.size(); ++p) sorted[p] = std::move(fasta[order[p]]);
+  fasta.swap(sorted);
   
   //setupBuffer
   int ret { std::system("rm -Rf smt_data") };
@@ -228,8 +227,7 @@ void processMT(const std::vector<std::string> &fasta, const int k, const int bsi
   smtdb.open("smt_data/SMT.db", std::ios::binary);
 
   // Number of batches
-  int nb, r;
-  std::tie(nb, r) = computeBatchSize(n, bsize);
+  const int nb = bounds.empty() ? 0 : bounds.size() - 1;
 
   // Metadata
   std::ofstream meta("smt_data/meta.txt");
@@ -239,9 +237,7 @@ void processMT(const std::vector<std::string> &fasta, const int k, const int bsi
 
   // Processing
   tbb::parallel_for(0, nb, [&](const auto i) {
-    auto start = i * bsize;
-    auto end = (i + 1) * bsize;
-    auto *M = createDenseMT(fasta, k, start, end);
+    auto *M = createDenseMT(fasta, k, bounds[i], bounds[i + 1]);
     auto *S = new arma::SpMat<uint64_t>(*M);
     delete M;
 
@@ -254,16 +250,6 @@ void processMT(const std::vector<std::string> &fasta, const int k, const int bsi
 
   std::unique_lock<std::mutex> lock(mtx);
   wrt.wait(lock, [] { return done_writing.load(); });
-    
-  if (r != 0) {
-    int start { nb * bsize };
-    int end { nb * bsize + r };
-    const auto *M { createDenseMT(fasta, k, start, end) };
-    const auto *S { new arma::SpMat<uint64_t>(*M) };
-    delete M;
-    S->save(smtdb, arma::arma_binary);
-    delete S;
-  }
 
   smtdb.close();
 
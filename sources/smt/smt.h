@@ -17,7 +17,8 @@
 #include <queue>
 #include <condition_variable>
 #include <atomic>
+#include "batches.h"
 
 
 void saveMT();
-void processMT(const std::vector<std::string> &fasta, const int k, const int bsize);
+void processMT(std::vector<std::string> fasta, const int k, const int bsize);
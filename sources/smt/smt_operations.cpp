@@ -1,6 +1,5 @@
 #include "smt_operations.h"
 #include "smt_utils.h"
-#include <stack>
 using namespace tbb;
 
 extern std::vector<std::string> fasta;
@@ -52,89 +51,181 @@ int hDist(const std::string &str1, const std::string &str2) {
   return std::inner_product(str1.begin(), str1.end(), str2.begin(), 0, std::plus<>(), std::not_equal_to<>());
 }
 
-//'Kmer direct Search.
+//'Compare one window against all seeds with scalar XOR/popcount.
+//'@name scan_window.
+//'@param window Kmer index of the window.
+//'@param seeds Kmer indexes of the seeds, padded to a multiple of 4.
+//'@param nseeds Number of seeds.
+//'@param d Number of mutations allowed.
+//'@param hits Seed positions with up to d mutations from window.
+void scan_window(uint64_t window, const uint64_t *seeds, size_t nseeds, int d, std::vector<uint32_t> &hits) {
+  for (size_t s = 0; s < nseeds; ++s) {
+    if (hDist2bit(window, seeds[s]) <= d) hits.push_back(s);
+  }
+}
+
+//'Compare one window against all seeds, 4 seeds per AVX2 instruction.
+//'@name scan_window_avx2.
+//'@param window Kmer index of the window.
+//'@param seeds Kmer indexes of the seeds, padded to a multiple of 4.
+//'@param nseeds Number of seeds.
+//'@param d Number of mutations allowed.
+//'@param hits Seed positions with up to d mutations from window.
+__attribute__((target("avx2")))
+void scan_window_avx2(uint64_t window, const uint64_t *seeds, size_t nseeds, int d, std::vector<uint32_t> &hits) {
+  const __m256i w = _mm256_set1_epi64x(window);
+  const __m256i odd = _mm256_set1_epi64x(0x5555555555555555ULL);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i limit = _mm256_set1_epi64x(d);
+  
+  for (size_t s = 0; s < nseeds; s += 4) {
+    __m256i x = _mm256_xor_si256(w, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(seeds + s)));
+    x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 1)), odd);
+    
+    // Popcount of each 64 bits lane with nibble lookup
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+                                    _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi64(x, 4), low)));
+    __m256i dist = _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+    
+    int far = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(dist, limit)));
+    int near = ~far & 0xf;
+    while (near) {
+      int lane = __builtin_ctz(near);
+      if (s + lane < nseeds) hits.push_back(s + lane);
+      near &= near - 1;
+    }
+  }
+}
+
+//'Kmer direct Search over 2 bits encoded windows, in parallel by sequence.
 //'@name busca_direta.
 //'@param fasta Dataset of sequences.
 //'@param kmers kmers to find sibligs.
 //'@param d Number of mutations allowed.
-//'@return C++ String HashMap of siblings of kmers.
-std::map<std::string, std::map<std::string, int>> busca_direta(std::vector<std::string> &fasta, std::vector<std::string> &kmers, int d) {
-  int n = fasta.size();
-  int t = fasta[0].size();
-  int k = kmers[0].size();
-  int m = t - k + 1;
-  std::map<std::string, std::map<std::string, int>> hmap;
-
-  for (int i = 0; i < n; ++i) {
-    std::string seq = fasta[i];
-    for (int j = 0; j < m; ++j) {
-      std::string km = seq.substr(j, k);
-      for (const auto &kmer : kmers) {
-        int e = hDist(kmer, km);
-        if (e <= d) {
-          hmap[kmer][km] += 1;
+//'@return HashMap of siblings of kmers by kmer index, ordered like the kmer strings.
+std::map<uint64_t, std::map<uint64_t, int>> busca_direta(std::vector<std::string> &fasta, std::vector<std::string> &kmers, int d) {
+  const size_t n = fasta.size();
+  const size_t nseeds = kmers.size();
+  const int k = kmers[0].size();
+  const uint64_t mask = (k == 32) ? ~0ULL : ((1ULL << (2 * k)) - 1);
+  
+  std::vector<uint64_t> seeds((nseeds + 3) / 4 * 4, ~0ULL);
+  for (size_t s = 0; s < nseeds; ++s) seeds[s] = kmer2index(kmers[s]);
+  
+  const auto scan = __builtin_cpu_supports("avx2") ? scan_window_avx2 : scan_window;
+  tbb::enumerable_thread_specific<std::vector<std::unordered_map<uint64_t, int>>> local_hmaps(nseeds);
+  
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, n), [&](const auto &r) {
+    auto &local = local_hmaps.local();
+    std::vector<uint32_t> hits;
+    
+    for (size_t i = r.begin(); i != r.end(); ++i) {
+      const std::string &seq = fasta[i];
+      uint64_t window = 0;
+      int valid = 0;
+      
+      for (size_t j = 0; j < seq.size(); ++j) {
+        int symbol;
+        switch(seq[j]) {
+          case 'A': symbol = 0; break;
+          case 'C': symbol = 1; break;
+          case 'G': symbol = 2; break;
+          case 'T': symbol = 3; break;
+          default: symbol = -1;
         }
+        
+        // Windows with other symbols are skipped
+        if (symbol < 0) {
+          valid = 0;
+          continue;
+        }
+        
+        window = ((window << 2) | symbol) & mask;
+        if (++valid < k) continue;
+        
+        hits.clear();
+        scan(window, seeds.data(), nseeds, d, hits);
+        for (const auto s : hits) local[s][window] += 1;
       }
     }
+  });
+  
+  // Merge per-thread buffers
+  std::map<uint64_t, std::map<uint64_t, int>> hmap;
+  for (const auto &local : local_hmaps) {
+    for (size_t s = 0; s < nseeds; ++s) {
+      if (local[s].empty()) continue;
+      auto &sibs = hmap[seeds[s]];
+      for (const auto &kv : local[s]) sibs[kv.first] += kv.second;
+    }
   }
-
+  
   return hmap;
 }
 
-//'Count kmers in a SMT tree.
+//'Count kmers below a SMT node with an explicit stack.
 //'@name count_kmers.
 //'@param S SMT data.
-//'@param hmap C++ String Hash Map.
-//'@param kmer Kmer for counting.
-//'@param kmax Size of kmer.
+//'@param hmap Thread local map of kmer index and counts.
+//'@param index Index of the kmer prefix already walked.
+//'@param kmax Size of kmer stored in the SMT.
+//'@param k Size of the kmer of interest.
 //'@param j Start index of kmer. Does not need be 0.
 //'@param node Current node. Does not be root.
-//'@return hmap[kmer] += count.
-void count_kmers(const arma::SpMat<uint64_t> &S, concurrent_hash_map<std::string, uint64_t> &hmap, const std::string &kmer, const int kmax, int j, int node) {
-  
-  if (j == kmax) {
-    int count = S(node, 4);
-    
-    // Atualização thread-safe usando TBB
-    concurrent_hash_map<std::string, uint64_t>::accessor acc;
-    hmap.insert(acc, kmer);
-    acc->second += count;
-    
-    return;
-  }
-  
-  // Executa as iterações em paralelo usando TBB
-  parallel_for(0, 4, 1, [&](size_t i) {
-    int next = S(node, i);
-    if (next > 0) {
-      count_kmers(S, hmap, kmer, kmax, j + 1, next);
+//'@return hmap[index] += count.
+void count_kmers(const arma::SpMat<uint64_t> &S, std::unordered_map<uint64_t, uint64_t> &hmap, uint64_t index, const int kmax, const int k, int j, uint64_t node) {
+  struct Frame {
+    uint64_t node, index;
+    int j;
+  };
+
+  std::vector<Frame> pilha;
+  pilha.push_back({node, index, j});
+
+  while (!pilha.empty()) {
+    Frame frame = pilha.back();
+    pilha.pop_back();
+
+    if (frame.j == kmax) {
+      hmap[frame.index] += S(frame.node, 4);
+      continue;
     }
-  });
+
+    for (uint64_t i = 0; i < 4; ++i) {
+      uint64_t next = S(frame.node, i);
+      if (next > 0) {
+        uint64_t index = (frame.j < k) ? frame.index * 4 + i : frame.index;
+        pilha.push_back({next, index, frame.j + 1});
+      }
+    }
+  }
 }
 
-//'Auxiliary function to hash.
+//'Auxiliary function to hash. Spawns tasks only above depth, below it each task counts serially.
 //'@name hash_.
 //'@param S SMT data.
-//'@param hmap C++ String Hash Map.
-//'@param kmer Kmer for hashing.
+//'@param hmap Thread local maps of kmer index and counts.
+//'@param index Index of the kmer prefix already walked.
 //'@param kmax kmax Max size of kmer.
 //'@param k Size of the kmer of interest.
+//'@param depth Last trie level where new tasks are spawned.
 //'@oaram j Start index of kmer. Does not need be 0.
 //'@param node Current node. Does not be root.
-//'@nthreads Number os threads.
 //'@return Calls function count_kmers.
-void hash(const arma::SpMat<uint64_t> &S, concurrent_hash_map<std::string, uint64_t> &hmap, std::string kmer, const int kmax, const int k, int j, int node) {
+void hash(const arma::SpMat<uint64_t> &S, tbb::enumerable_thread_specific<std::unordered_map<uint64_t, uint64_t>> &hmap, uint64_t index, const int kmax, const int k, const int depth, int j, uint64_t node) {
   
-  if (j == k) {
-    count_kmers(S, hmap, kmer, kmax, j, node);
+  if (j >= depth || j == kmax) {
+    count_kmers(S, hmap.local(), index, kmax, k, j, node);
     return;
   }
   
   // Executa as iterações em paralelo usando TBB
-  parallel_for(0, 4, 1, [&](size_t i) {
-    int next = S(node, i);
+  parallel_for(0, 4, 1, [&](uint64_t i) {
+    uint64_t next = S(node, i);
     if (next > 0) {
-      hash(S, hmap, kmer + int2char(i), kmax, k, j + 1, next);
+      hash(S, hmap, (j < k) ? index * 4 + i : index, kmax, k, depth, j + 1, next);
     }
   });
 }
@@ -142,11 +233,10 @@ void hash(const arma::SpMat<uint64_t> &S, concurrent_hash_map<std::string, uint6
 //'Hash and count kmers.
 //'@name khmap.
 //'@param k Size of the kmer of interest.
-//'@param path Path to SMT data.
-//'@nthreads Number os threads.
-//'@return C++ String HashMap of kmers and your counts.
-tbb::concurrent_hash_map<std::string, uint64_t> khmap(const int k) {
-  concurrent_hash_map<std::string, uint64_t> hmap;
+//'@param depth Last trie level where new tasks are spawned.
+//'@return C++ HashMap of kmer indexes and your counts.
+std::unordered_map<uint64_t, uint64_t> khmap(const int k, const int depth) {
+  enumerable_thread_specific<std::unordered_map<uint64_t, uint64_t>> local_hmaps;
   
   // Ler metadados
   int kmax, nb;
@@ -170,94 +260,57 @@ tbb::concurrent_hash_map<std::string, uint64_t> khmap(const int k) {
     {std::lock_guard lock(mtx); S.load(smtdb, arma::arma_binary);}
     
     
-    hash(S, hmap, "", kmax, k, 0, 0);
+    hash(S, local_hmaps, 0, kmax, k, depth, 0, 0);
   });
   
   smtdb.close();
   
-  return hmap;
-}
-
-//'Auxiliary Recursive kdive function.
-//'@name kdive_.
-//'@param M SMT data.
-//'@param hmap C++ String HashMap for store sibligs.
-//'@param kmer Kmer for search siblings.
-//'@param k Size of kmer.
-//'@param d Number of mutations allowed.
-//'@param node Root of SMT.
-//'@param l Current number of mutations. Needs to be less than k.
-//'@param j Current index of kmer.
-void kdive_(const arma::Mat<uint64_t> &M, tbb::concurrent_hash_map<std::string, tbb::concurrent_hash_map<std::string, uint64_t>> &hmap, const std::string &kmer, const int &k, const int &d, int node, int l, int j) {
-  
-  if (j == k) {
-    tbb::concurrent_hash_map<std::string, tbb::concurrent_hash_map<std::string, uint64_t>>::accessor outer_acc;
-    tbb::concurrent_hash_map<std::string,uint64_t>::accessor inner_acc;
-
-    if (hmap.insert(outer_acc, kmer)) outer_acc->second = tbb::concurrent_hash_map<std::string, uint64_t>();
-    
-    if (outer_acc->second.insert(inner_acc, index2kmer(M(node, 5), k))) inner_acc->second = 0;
-    inner_acc->second += M(node, 4);
-    
-    inner_acc.release();
-    outer_acc.release();
-    return;
+  // Merge per-thread buffers
+  std::unordered_map<uint64_t, uint64_t> hmap;
+  for (const auto &local : local_hmaps) {
+    for (const auto &kv : local) hmap[kv.first] += kv.second;
   }
   
-  tbb::parallel_for(0, 4, 1, [&](size_t i) {
-    int next = M(node, i);
-    if (next != 0) {
-      char c = int2char(i);
-      int hd = (kmer[j] == c) ? 0 : 1;
-      if (l + hd <= d) {
-        kdive_(M, hmap, kmer, k, d, next, l + hd, j + 1);
-      }
-    }
-  });
+  return hmap;
 }
 
 //'Auxiliary Iterative kdive function.
-//'@name kdive_.
+//'@name kdive_iterativo.
 //'@param M SMT data.
-//'@param hmap C++ String HashMap for store sibligs.
+//'@param sibs Thread local map of sibling indexes and counts.
 //'@param kmer Kmer for search siblings.
 //'@param k Size of kmer.
 //'@param d Number of mutations allowed.
-void kdive_iterativo(const arma::Mat<uint64_t> &M, tbb::concurrent_hash_map<std::string, tbb::concurrent_hash_map<std::string, uint64_t>> &hmap, const std::string &kmer, const int &k, const int &d) {
+//'@param node Start node of the traversal.
+//'@param l Current number of mutations.
+//'@param j Current index of kmer.
+void kdive_iterativo(const arma::Mat<uint64_t> &M, std::unordered_map<uint64_t, uint64_t> &sibs, const std::string &kmer, const int &k, const int &d, uint64_t node, int l, int j) {
     struct Frame {
-        int node, l, j;
+        uint64_t node;
+        int l, j;
     };
     
-    std::stack<Frame> pilha;
-    pilha.push({0, 0, 0});  // Inicializa a pilha com o estado inicial
+    std::vector<Frame> pilha;
+    pilha.push_back({node, l, j});  // Inicializa a pilha com o estado inicial
 
     while (!pilha.empty()) {
-        Frame frameAtual = pilha.top();
-        pilha.pop();
+        Frame frameAtual = pilha.back();
+        pilha.pop_back();
 
-        int node = frameAtual.node;
+        uint64_t node = frameAtual.node;
         int l = frameAtual.l;
         int j = frameAtual.j;
 
         if (j == k) {
-            tbb::concurrent_hash_map<std::string, tbb::concurrent_hash_map<std::string, uint64_t>>::accessor outer_acc;
-            tbb::concurrent_hash_map<std::string,uint64_t>::accessor inner_acc;
-
-            if (hmap.insert(outer_acc, kmer)) outer_acc->second = tbb::concurrent_hash_map<std::string, uint64_t>();
-            
-            if (outer_acc->second.insert(inner_acc, index2kmer(M(node, 5), k))) inner_acc->second = 0;
-            inner_acc->second += M(node, 4);
-            
-            inner_acc.release();
-            outer_acc.release();
+            sibs[M(node, 5)] += M(node, 4);
         } else {
             for (size_t i = 0; i < 4; ++i) {
-                int next = M(node, i);
+                uint64_t next = M(node, i);
                 if (next != 0) {
                     char c = int2char(i);
                     int hd = (kmer[j] == c) ? 0 : 1;
                     if (l + hd <= d) {
-                        pilha.push({next, l + hd, j + 1});  // Empilha o próximo estado
+                        pilha.push_back({next, l + hd, j + 1});  // Empilha o próximo estado
                     }
                 }
             }
@@ -265,16 +318,47 @@ void kdive_iterativo(const arma::Mat<uint64_t> &M, tbb::concurrent_hash_map<std:
     }
 }
 
+//'Auxiliary Recursive kdive function. Spawns tasks only above depth, below it uses kdive_iterativo.
+//'@name kdive_.
+//'@param M SMT data.
+//'@param sibs Thread local buffers of siblings, one map for each kmer.
+//'@param kmer Kmer for search siblings.
+//'@param s Index of kmer in the kmers list.
+//'@param k Size of kmer.
+//'@param d Number of mutations allowed.
+//'@param depth Last trie level where new tasks are spawned.
+//'@param node Root of SMT.
+//'@param l Current number of mutations. Needs to be less than k.
+//'@param j Current index of kmer.
+void kdive_(const arma::Mat<uint64_t> &M, tbb::enumerable_thread_specific<std::vector<std::unordered_map<uint64_t, uint64_t>>> &sibs, const std::string &kmer, const size_t s, const int &k, const int &d, const int &depth, uint64_t node, int l, int j) {
+  
+  if (j >= depth || j == k) {
+    kdive_iterativo(M, sibs.local()[s], kmer, k, d, node, l, j);
+    return;
+  }
+  
+  tbb::parallel_for(0, 4, 1, [&](size_t i) {
+    uint64_t next = M(node, i);
+    if (next != 0) {
+      char c = int2char(i);
+      int hd = (kmer[j] == c) ? 0 : 1;
+      if (l + hd <= d) {
+        kdive_(M, sibs, kmer, s, k, d, depth, next, l + hd, j + 1);
+      }
+    }
+  });
+}
+
 //'Search all siblings of a kmers. Do not use this function! Use hsib or fast_hsib.
 //'@name kdive.
 //'@param kmers List of kmers for search siblings.
 //'@param d Number of mutations allowed.
-//'@param path Path to SMT data.
-//'@param nthreads Numbers of threads.
-//'@return C++ String HashMap of siblings of kmers.
-tbb::concurrent_hash_map<std::string, tbb::concurrent_hash_map<std::string, uint64_t>> kdive(const std::vector<std::string> &kmers, const int d) {
+//'@param depth Last trie level where new tasks are spawned.
+//'@return One HashMap of sibling indexes and counts for each kmer.
+std::vector<std::unordered_map<uint64_t, uint64_t>> kdive(const std::vector<std::string> &kmers, const int d, const int depth) {
   
-  tbb::concurrent_hash_map<std::string, tbb::concurrent_hash_map<std::string, uint64_t>> hmap;
+  const size_t nkmers = kmers.size();
+  tbb::enumerable_thread_specific<std::vector<std::unordered_map<uint64_t, uint64_t>>> sibs(nkmers);
   
   // Open and read metadata
   std::ifstream meta("smt_data/meta.txt");
@@ -291,42 +375,148 @@ tbb::concurrent_hash_map<std::string, tbb::concurrent_hash_map<std::string, uint
     S.load(smtdb);
 
     M = S;
-    for (const auto &kmer : kmers) kdive_(M, hmap, kmer, k, d,0,0,0);
+    tbb::parallel_for(size_t(0), nkmers, [&](size_t s) {
+      kdive_(M, sibs, kmers[s], s, k, d, depth, 0, 0, 0);
+    });
   }
   
   smtdb.close();
+  
+  // Merge per-thread buffers
+  std::vector<std::unordered_map<uint64_t, uint64_t>> hmap(nkmers);
+  tbb::parallel_for(size_t(0), nkmers, [&](size_t s) {
+    for (const auto &local : sibs) {
+      for (const auto &kv : local[s]) hmap[s][kv.first] += kv.second;
+    }
+  });
+  
+  return hmap;
+}
+
+//'Search all siblings of a kmers with the multi-index hash of the hmap instead of the SMT.
+//'@name kdive.
+//'@param index Multi-index hash built over the hmap.
+//'@param kmers List of kmers for search siblings.
+//'@param d Number of mutations allowed.
+//'@return One HashMap of sibling indexes and counts for each kmer.
+std::vector<std::unordered_map<uint64_t, uint64_t>> kdive(const MultiIndex &index, const std::vector<std::string> &kmers, const int d) {
+  
+  std::vector<std::unordered_map<uint64_t, uint64_t>> hmap(kmers.size());
+  
+  tbb::parallel_for(size_t(0), kmers.size(), [&](size_t s) {
+    std::vector<uint32_t> hits;
+    searchMIH(index, kmer2index(kmers[s]), d, hits);
+    for (const auto id : hits) hmap[s][index.codes[id]] += index.counts[id];
+  });
+  
   return hmap;
 }
 
+//'Enumerate all kmers with up to d mutations from a kmer index.
+//'@name neighborhood.
+//'@param index Kmer index in 2 bits per symbol.
+//'@param k Size of kmer.
+//'@param d Number of mutations allowed.
+//'@param j First position that can be mutated.
+//'@param visit Called once for each sibling index.
+template <typename F>
+void neighborhood(uint64_t index, const int k, const int d, int j, F &visit) {
+  visit(index);
+  if (d == 0) return;
+  
+  for (int p = j; p < k; ++p) {
+    int shift = 2 * (k - 1 - p);
+    uint64_t symbol = (index >> shift) & 3;
+    for (uint64_t c = 1; c < 4; ++c) {
+      uint64_t sibling = index ^ (((symbol ^ ((symbol + c) & 3)) & 3) << shift);
+      neighborhood(sibling, k, d - 1, p + 1, visit);
+    }
+  }
+}
+
+//'Number of kmers with up to d mutations, sum of C(k, i) * 3^i.
+//'@name neighborhood_size.
+//'@param k Size of kmer.
+//'@param d Number of mutations allowed.
+//'@return Size of the d-neighborhood of a kmer.
+double neighborhood_size(const int k, const int d) {
+  double total = 0.0;
+  double binom = 1.0;
+  for (int i = 0; i <= d && i <= k; ++i) {
+    total += binom * std::pow(3.0, i);
+    binom = binom * (k - i) / (i + 1);
+  }
+  return total;
+}
+
 //'Search siblings of kmers in a hmap data.
-//'@name fast_hsib.
-//'@param hmap HashMap of kmers and yours counts.
+//'@name hsib.
+//'@param hmap Binary hmap with sorted kmer indexes and counts.
 //'@param kmers Kmers to search siblings.
 //'@param d Number of mutations allowed.
-//'@param nthread Number os threads.
-//'@return C++ String HashMap of siblings of kmers.
-void hsib(const tbb::concurrent_hash_map <std::string, uint64_t> &hmap, const std::vector<std::string> &kmers, const int d) {
+//'@return Writes one file of siblings for each kmer in smt_data/hsib_dir.
+void hsib(const HmapView &hmap, const std::vector<std::string> &kmers, const int d) {
   
   int ret = system("rm -Rf smt_data/hsib_dir");
   mkdir("smt_data/hsib_dir", 0777);
+  
+  // Full scan costs |hmap| per kmer, enumeration costs one binary search per sibling.
+  const int k = hmap.k;
+  const uint64_t n = hmap.n;
+  const bool enumerate = neighborhood_size(k, d) * std::log2(double(n) + 1) < double(n);
+  
   tbb::parallel_for(size_t(0), kmers.size(), [&](size_t i) {
-    std::string kmer = kmers[i];
-    std::ofstream fhsib("smt_data/hsib_dir/" + kmer + ".txt");
+    const std::string &kmer = kmers[i];
+    const uint64_t index = kmer2index(kmer);
+    std::ostringstream buffer;
     
-    for (auto it = hmap.begin(); it != hmap.end(); ++it) {
-      const auto &km = it->first;
-      const auto &count = it->second;
-      int hd = hDist(km, kmer);
-      if (hd <= d) {
-        fhsib << km << ' ' << count << std::endl;
+    if (enumerate) {
+      auto visit = [&](uint64_t sibling) {
+        uint64_t count = hmapCount(hmap, sibling);
+        if (count > 0) buffer << index2kmer(sibling, k) << ' ' << count << '\n';
+      };
+      neighborhood(index, k, d, 0, visit);
+    }
+    
+    else {
+      for (uint64_t j = 0; j < n; ++j) {
+        if (hDist2bit(hmap.codes[j], index) <= d) {
+          buffer << index2kmer(hmap.codes[j], k) << ' ' << hmap.counts[j] << '\n';
+        }
       }
     }
     
+    std::ofstream fhsib("smt_data/hsib_dir/" + kmer + ".txt");
+    fhsib << buffer.str();
     fhsib.close();
     
   });
 }
 
-
-
-
+//'Search siblings of kmers with the multi-index hash of the hmap.
+//'@name hsib.
+//'@param index Multi-index hash built over the hmap.
+//'@param kmers Kmers to search siblings.
+//'@param d Number of mutations allowed.
+//'@return Writes one file of siblings for each kmer in smt_data/hsib_dir.
+void hsib(const MultiIndex &index, const std::vector<std::string> &kmers, const int d) {
+  
+  int ret = system("rm -Rf smt_data/hsib_dir");
+  mkdir("smt_data/hsib_dir", 0777);
+  
+  tbb::parallel_for(size_t(0), kmers.size(), [&](size_t i) {
+    const std::string &kmer = kmers[i];
+    std::vector<uint32_t> hits;
+    searchMIH(index, kmer2index(kmer), d, hits);
+    
+    std::ostringstream buffer;
+    for (const auto id : hits) {
+      buffer << index2kmer(index.codes[id], index.k) << ' ' << index.counts[id] << '\n';
+    }
+    
+    std::ofstream fhsib("smt_data/hsib_dir/" + kmer + ".txt");
+    fhsib << buffer.str();
+    fhsib.close();
+    
+  });
+}
@@ -4,20 +4,27 @@
 #include <stdexcept>
 #include <omp.h>
 #include <map>
+#include <unordered_map>
 #include <numeric>
 #include <algorithm>
+#include <sstream>
+#include <cmath>
 #include <stdexcept>
 #include<iostream>
 #include<fstream>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <immintrin.h>
 #include <tbb/concurrent_hash_map.h>
 #include <tbb/parallel_for.h>
 #include <tbb/tbb.h>
+#include "mih.h"
+#include "hmap_io.h"
 
 int ksearch(const std::string kmer);
-tbb::concurrent_hash_map<std::string, uint64_t> khmap(const int k);
-void hsib(const tbb::concurrent_hash_map <std::string, uint64_t> &hmap, const std::vector<std::string> &kmers, const int d);
-std::map<std::string, std::map<std::string, int>> busca_direta(std::vector<std::string> &fasta, std::vector<std::string> &kmers, int d);
-tbb::concurrent_hash_map<std::string, tbb::concurrent_hash_map<std::string, uint64_t>> kdive(const std::vector<std::string> &kmers, const int d);
-
+std::unordered_map<uint64_t, uint64_t> khmap(const int k, const int depth);
+void hsib(const MultiIndex &index, const std::vector<std::string> &kmers, const int d);
+void hsib(const HmapView &hmap, const std::vector<std::string> &kmers, const int d);
+std::map<uint64_t, std::map<uint64_t, int>> busca_direta(std::vector<std::string> &fasta, std::vector<std::string> &kmers, int d);
+std::vector<std::unordered_map<uint64_t, uint64_t>> kdive(const std::vector<std::string> &kmers, const int d, const int depth);
+std::vector<std::unordered_map<uint64_t, uint64_t>> kdive(const MultiIndex &index, const std::vector<std::string> &kmers, const int d);
\ No newline at end of file
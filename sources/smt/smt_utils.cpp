@@ -1,4 +1,5 @@
 #include "smt_utils.h"
+#include "hmap_io.h"
 
 #include <iostream>
 #include <fstream>
@@ -26,27 +27,25 @@ std::vector<std::string> readkmers(const std::string &path) {
   return kmers;
 }
 
-//'Read hash map in format XXXXX COUNT. 
+//'Read binary hash map written by hmap. 
 //'@name readhmap
-//'@param filename Path to hash map.
+//'@param filename Path to hash map, usually smt_data/hmap.bin.
 //'@return C++ String Map.
 std::unordered_map<std::string, uint64_t> readhmap(const std::string &filename) {
 
   std::unordered_map<std::string, uint64_t> hmap;
 
-  std::ifstream file(filename); // Abre o arquivo especificado pelo nome
-
-  if (!file.is_open()) {
+  HmapView view;
+  if (!openHmap(view, filename)) {
     std::cerr << "Não foi possível abrir o arquivo!\n";
+    return hmap;
   }
 
-  std::string kmer;
-  uint64_t count;
-  while (file >> kmer >> count) { // Lê o kmer e a contagem
-    hmap[kmer] = count; // Insere no mapa
+  hmap.reserve(view.n);
+  for (uint64_t i = 0; i < view.n; ++i) {
+    hmap[index2kmer(view.codes[i], view.k)] = view.counts[i];
   }
 
-  file.close();
   return hmap;
 }
 
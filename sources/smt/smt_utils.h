@@ -13,4 +13,15 @@ std::string index2kmer(uint64_t index, int k);
 std::vector<std::string> readkmers(const std::string &path);
 std::vector<std::string> readFasta(const std::string& filepath);
 std::vector<std::string> getFilenames(const std::string& dirPath);
-std::unordered_map<std::string, uint64_t> readhmap(const std::string &filename);
\ No newline at end of file
+std::unordered_map<std::string, uint64_t> readhmap(const std::string &filename);
+
+//'Hamming distance between two kmer indexes with 2 bits per symbol.
+//'@name hDist2bit.
+//'@param a First kmer index.
+//'@param b Second kmer index.
+//'@return Number of symbols that differ between a and b.
+inline int hDist2bit(uint64_t a, uint64_t b) {
+  uint64_t x = a ^ b;
+  x = (x | (x >> 1)) & 0x5555555555555555ULL;
+  return __builtin_popcountll(x);
+}
@@ -0,0 +1,132 @@
+#include "batches.h"
+
+//'Length of each sequence of the dataset.
+//'@name sequenceLengths
+//'@param fasta Dataset of sequences.
+//'@return Vector with the size of each sequence.
+std::vector<size_t> sequenceLengths(const std::vector<std::string> &fasta) {
+  std::vector<size_t> lengths(fasta.size());
+  for (size_t i = 0; i < fasta.size(); ++i) lengths[i] = fasta[i].size();
+  return lengths;
+}
+
+//'Sequence indexes grouped by length bucket, in the original order inside each bucket.
+//'Sequences shorter than k have no window and are left out.
+//'@name lengthOrder
+//'@param lengths Size of each sequence.
+//'@param k Size of the kmers or motif.
+//'@return Indexes of the sequences with at least k symbols, shortest buckets first.
+std::vector<size_t> lengthOrder(const std::vector<size_t> &lengths, const int k) {
+  std::vector<size_t> order;
+  order.reserve(lengths.size());
+  for (size_t i = 0; i < lengths.size(); ++i) if (lengths[i] >= size_t(k)) order.push_back(i);
+  
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return lengths[a] / LENGTH_BUCKET < lengths[b] / LENGTH_BUCKET;
+  });
+  
+  return order;
+}
+
+//'Split the sequences in batches of similar length. A batch is closed at the end of a
+//'length bucket, after bsize sequences, or when it holds the windows of bsize sequences
+//'of mean length, so batches of long sequences get fewer of them.
+//'@name lengthBatches
+//'@param lengths Size of each sequence.
+//'@param order Sequence indexes from lengthOrder.
+//'@param k Size of the kmers or motif.
+//'@param bsize Max number of sequences of a batch.
+//'@return Batch boundaries in order, batch b is order[bounds[b], bounds[b+1]).
+std::vector<size_t> lengthBatches(const std::vector<size_t> &lengths, const std::vector<size_t> &order, const int k, const size_t bsize) {
+  double windows = 0.0;
+  for (const auto i : order) windows += lengths[i] - k + 1;
+  const double budget = order.empty() ? 0.0 : bsize * windows / order.size();
+  
+  std::vector<size_t> bounds{0};
+  double current = 0.0;
+  for (size_t p = 0; p < order.size(); ++p) {
+    const size_t m = lengths[order[p]] - k + 1;
+    const size_t count = p - bounds.back();
+    const bool bucket = count > 0 && lengths[order[p]] / LENGTH_BUCKET != lengths[order[p - 1]] / LENGTH_BUCKET;
+    if (count > 0 && (bucket || count == bsize || current + m > budget)) {
+      bounds.push_back(p);
+      current = 0.0;
+    }
+    current += m;
+  }
+  if (!order.empty()) bounds.push_back(order.size());
+  
+  return bounds;
+}
+
+//'Split one record in overlapping tiles. Lowercase (soft-masked) symbols are kept as
+//'uppercase and any other symbol, as N, ends the current run.
+//'@name tileRecord
+//'@param record Sequence of the record.
+//'@param id Index of the record in the file.
+//'@param tile Max size of a tile, must be greater than overlap.
+//'@param overlap Symbols shared by consecutive tiles, k-1 for kmers of size k.
+//'@param tiles Receives the tiles with more than overlap symbols.
+//'@param coords Receives the position of each tile.
+void tileRecord(const std::string &record, const uint32_t id, const size_t tile, const int overlap, std::vector<std::string> &tiles, std::vector<TileCoord> &coords) {
+  if (tile <= size_t(overlap)) throw std::invalid_argument("Tamanho do tile deve ser maior que k-1");
+  const size_t step = tile - overlap;
+  
+  size_t j = 0;
+  while (j < record.size()) {
+    // Run of valid symbols [j, end)
+    size_t end = j;
+    while (end < record.size() && std::string("ACGTacgt").find(record[end]) != std::string::npos) ++end;
+    
+    if (end - j > size_t(overlap)) {
+      for (size_t start = j; ; start += step) {
+        const size_t stop = std::min(start + tile, end);
+        std::string seq = record.substr(start, stop - start);
+        for (auto &c : seq) c = std::toupper(c);
+        tiles.push_back(std::move(seq));
+        coords.push_back({id, start});
+        if (stop == end) break;
+      }
+    }
+    
+    j = end + 1;
+  }
+}
+
+//'Read fasta dataset in overlapping tiles. Unlike readFasta, records with N are kept and
+//'split at the N runs. Records are assembled one at a time but every tile is returned, so
+//'the whole dataset ends up in memory; to stream a genome use a FastaReader with tile set
+//'and readFastaBatch, as oops and zoops do with -batch.
+//'@name readFastaTiles
+//'@param filepath Path to fasta dataset.
+//'@param tile Max size of a tile.
+//'@param overlap Symbols shared by consecutive tiles, k-1 for kmers of size k.
+//'@param coords Receives the position of each tile.
+//'@return Tiles of all records in file order.
+std::vector<std::string> readFastaTiles(const std::string &filepath, const size_t tile, const int overlap, std::vector<TileCoord> &coords) {
+  std::ifstream file(filepath);
+  if (!file.is_open()) throw std::invalid_argument("Arquivo fasta não encontrado: " + filepath);
+  
+  std::vector<std::string> tiles;
+  std::string line;
+  std::string seq;
+  uint32_t id = 0;
+  bool started = false;
+  coords.clear();
+  
+  while (std::getline(file, line)) {
+    if (line[0] == '>') {
+      if (started) tileRecord(seq, id++, tile, overlap, tiles, coords);
+      seq.clear();
+      started = true;
+    }
+    
+    else if (started) {
+      seq += line;
+    }
+  }
+  
+  if (started) tileRecord(seq, id, tile, overlap, tiles, coords);
+  
+  return tiles;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cctype>
+
+// Sequences are grouped in buckets of LENGTH_BUCKET symbols so each batch holds
+// sequences of similar length and the work per batch stays balanced.
+#define LENGTH_BUCKET 64
+
+// Size of the tiles of a streamed background, long records are tiled so a whole
+// genome never needs more than one record in memory as a single sequence.
+#define TILE_SIZE 10000
+
+// Position of a tile in the fasta file. Records are split at every symbol other than
+// A, C, G and T, and each run is cut in tiles of up to tile symbols overlapping by
+// k-1, so each kmer of the record starts in exactly one tile.
+struct TileCoord {
+  uint32_t record;   // Index of the record in the file, from 0
+  uint64_t start;    // Offset of the tile in the record, from 0
+};
+
+std::vector<size_t> sequenceLengths(const std::vector<std::string> &fasta);
+std::vector<size_t> lengthOrder(const std::vector<size_t> &lengths, const int k);
+std::vector<size_t> lengthBatches(const std::vector<size_t> &lengths, const std::vector<size_t> &order, const int k, const size_t bsize);
+void tileRecord(const std::string &record, const uint32_t id, const size_t tile, const int overlap, std::vector<std::string> &tiles, std::vector<TileCoord> &coords);
+std::vector<std::string> readFastaTiles(const std::string &filepath, const size_t tile, const int overlap, std::vector<TileCoord> &coords);
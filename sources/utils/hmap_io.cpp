@@ -0,0 +1,175 @@
+#include "hmap_io.h"
+#include <algorithm>
+
+//'Append a varint (7 bits per byte) to a buffer.
+//'@name putVarint
+//'@param buffer Output buffer.
+//'@param value Value to encode.
+static void putVarint(std::vector<uint8_t> &buffer, uint64_t value) {
+  while (value >= 0x80) {
+    buffer.push_back(uint8_t(value) | 0x80);
+    value >>= 7;
+  }
+  buffer.push_back(uint8_t(value));
+}
+
+//'Read a varint from a buffer, without reading past its end.
+//'@name getVarint
+//'@param p Current position, advanced past the varint.
+//'@param end End of the buffer.
+//'@param value Decoded value.
+//'@return False if the varint is truncated or longer than 64 bits.
+static bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && p < end; shift += 7) {
+    const uint8_t byte = *p++;
+    value |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+HmapView::~HmapView() {
+  closeHmap(*this);
+}
+
+//'Open a binary hmap with mmap. The payload must hold exactly n codes and counts, or n
+//'varint pairs for compressed tables, and k must fit the 2 bits codes, otherwise the
+//'open fails.
+//'@name openHmap
+//'@param view View to fill.
+//'@param path Path to hmap.bin.
+//'@return True if the file is a valid hmap table.
+bool openHmap(HmapView &view, const std::string &path) {
+  closeHmap(view);
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(HmapHeader)) {
+    close(fd);
+    return false;
+  }
+
+  void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return false;
+
+  view.map = map;
+  view.length = st.st_size;
+
+  const auto *header = static_cast<const HmapHeader*>(map);
+  if (header->magic != HMAP_MAGIC || header->version != HMAP_VERSION || header->payload > view.length - sizeof(HmapHeader) || header->k == 0 || header->k > HMAP_MAX_K) {
+    closeHmap(view);
+    return false;
+  }
+
+  view.k = header->k;
+  view.n = header->n;
+  view.payload = header->payload;
+  const uint8_t *payload = static_cast<const uint8_t*>(map) + sizeof(HmapHeader);
+
+  if (header->flags & HMAP_COMPRESSED) {
+    // Each varint takes at least one byte, so n beyond the payload is a corrupt header
+    if (view.n > header->payload / 2) {
+      closeHmap(view);
+      return false;
+    }
+    view.decoded.resize(2 * view.n);
+    const uint8_t *p = payload;
+    const uint8_t *end = payload + header->payload;
+    uint64_t code = 0, value = 0;
+    for (uint64_t i = 0; i < 2 * view.n; ++i) {
+      if (!getVarint(p, end, value)) {
+        closeHmap(view);
+        return false;
+      }
+      if (i < view.n) code += value;
+      view.decoded[i] = i < view.n ? code : value;
+    }
+    if (p != end) {
+      closeHmap(view);
+      return false;
+    }
+    view.codes = view.decoded.data();
+    view.counts = view.decoded.data() + view.n;
+  }
+
+  else {
+    if (view.n > header->payload / 16 || header->payload != 2 * view.n * sizeof(uint64_t)) {
+      closeHmap(view);
+      return false;
+    }
+    // Lookups are binary searches, so no readahead hint
+    view.codes = reinterpret_cast<const uint64_t*>(payload);
+    view.counts = view.codes + view.n;
+  }
+
+  return true;
+}
+
+//'Release the mmap of a hmap view.
+//'@name closeHmap
+//'@param view View to close.
+void closeHmap(HmapView &view) {
+  if (view.map) munmap(view.map, view.length);
+  view.map = nullptr;
+  view.length = 0;
+  view.k = 0;
+  view.n = 0;
+  view.payload = 0;
+  view.codes = nullptr;
+  view.counts = nullptr;
+  view.decoded.clear();
+}
+
+//'Count of a kmer in the table by binary search.
+//'@name hmapCount
+//'@param view Open hmap view.
+//'@param code Kmer index.
+//'@return Count of the kmer, 0 if absent.
+uint64_t hmapCount(const HmapView &view, const uint64_t code) {
+  const uint64_t *it = std::lower_bound(view.codes, view.codes + view.n, code);
+  if (it == view.codes + view.n || *it != code) return 0;
+  return view.counts[it - view.codes];
+}
+
+//'Write a binary hmap.
+//'@name writeHmap
+//'@param path Path to hmap.bin.
+//'@param k Size of kmers.
+//'@param codes Kmer indexes sorted in increasing order.
+//'@param counts Counts of each kmer in codes.
+//'@param compress Store varint deltas instead of raw 64 bits arrays.
+//'@return True if the file was written.
+bool writeHmap(const std::string &path, const int k, const std::vector<uint64_t> &codes, const std::vector<uint64_t> &counts, const bool compress) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) return false;
+
+  HmapHeader header{HMAP_MAGIC, HMAP_VERSION, uint32_t(k), compress ? HMAP_COMPRESSED : 0u, codes.size(), 0};
+
+  if (compress) {
+    std::vector<uint8_t> buffer;
+    buffer.reserve(codes.size() * 3);
+    uint64_t previous = 0;
+    for (const auto code : codes) {
+      putVarint(buffer, code - previous);
+      previous = code;
+    }
+    for (const auto count : counts) putVarint(buffer, count);
+
+    header.payload = buffer.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  }
+
+  else {
+    header.payload = 2 * codes.size() * sizeof(uint64_t);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(codes.data()), codes.size() * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(uint64_t));
+  }
+
+  return file.good();
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define HMAP_MAGIC 0x4d484d42    // "BMHM"
+#define HMAP_VERSION 1
+#define HMAP_COMPRESSED 1
+#define HMAP_MAX_K 32           // Kmers of up to 32 symbols fit the 64 bits codes
+
+// Binary count table written by hmap in smt_data/hmap.bin.
+// Header followed by the kmer indexes (2 bits per symbol, sorted) and their counts.
+// With HMAP_COMPRESSED the indexes are stored as varint deltas and the counts as varints.
+struct HmapHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t k;
+  uint32_t flags;
+  uint64_t n;
+  uint64_t payload;
+};
+
+// Read only view of a hmap.bin file. Uncompressed tables point straight into the mmap.
+struct HmapView {
+  int k = 0;
+  uint64_t n = 0;
+  uint64_t payload = 0;            // Bytes of the table after the header, as stored
+  const uint64_t *codes = nullptr;
+  const uint64_t *counts = nullptr;
+
+  void *map = nullptr;
+  size_t length = 0;
+  std::vector<uint64_t> decoded;
+
+  HmapView() = default;
+  HmapView(const HmapView&) = delete;
+  HmapView &operator=(const HmapView&) = delete;
+  ~HmapView();
+};
+
+bool openHmap(HmapView &view, const std::string &path);
+void closeHmap(HmapView &view);
+uint64_t hmapCount(const HmapView &view, const uint64_t code);
+bool writeHmap(const std::string &path, const int k, const std::vector<uint64_t> &codes, const std::vector<uint64_t> &counts, const bool compress);
@@ -1,6 +1,10 @@
 #include "prob_utils.h"
 #include "utils.h"
-std::mt19937 gen(std::random_device{}()); 
+#include "pwm_kernels.h"
+#include <tbb/parallel_for.h>
+#include <sys/stat.h>
+#include <filesystem>
+#include <fstream>
 
 //'Check if EM is converged.
 //'@name hasConverged
@@ -20,11 +24,27 @@ bool hasConverged(const double cutoff, const int niter, const arma::mat &alpha,
   return false;
 }
 
+//'Check if EM is converged by the log-likelihood of the E-step normalizers.
+//'@name hasConvergedLL
+//'@param cutoff If the change of log-likelihood per sequence is less than cutoff, EM has converged.
+//'@param niter Remaining iterations.
+//'@param ll Log-likelihood of the current parameters.
+//'@param n Number of sequences.
+//'@param lls Log-likelihood of each iteration.
+//'@return True or False dependent on whether the EM has converged or not.
+bool hasConvergedLL(const double cutoff, const int niter, const double ll, const size_t n, std::vector<double> &lls) {
+  lls.push_back(ll);
+  double change = step_size(lls) / n;
+  if (niter <= 0 || change < cutoff) return true;
+  
+  return false;
+}
+
 //'Compute the step-size for EM convergence.
 //'@name step_size
 //'@param convergence Convergence vector.
 //'@return The abs of difference between the 2 last positions of convercence vector.
-double step_size(std::vector<double> convergence) {
+double step_size(const std::vector<double> &convergence) {
    int n = convergence.size();
    double change = std::abs(convergence[n - 2] - convergence[n - 1]);
    return change;
@@ -40,14 +60,18 @@ double Q(const std::string &mod, const std::vector<std::string> &fasta, const ar
    double q = 0.0;
    int k = alpha.n_cols;
    int n = fasta.size();
-   int t = fasta[0].size();
-   int m = t - k + 1;
+   
+   const arma::mat alphalog = arma::log(alpha);
    
    for (int i = 0; i < n; ++i) {
      const auto &seq = fasta[i];
-     double intern_sum = 0.0;
+     const int t = seq.size();
+     const int m = t - k + 1;
+     if (m <= 0) continue;
+     const arma::vec prefix = backgroundPrefix(seq, beta);
+     double intern_sum = m * prefix[t];
      for (int j = 0; j < m; ++j) {
-       intern_sum += probSeqGivenPosLog(seq, alpha, beta, j);
+       intern_sum += logOdds(seq, alphalog, prefix, j);
      }
      q += intern_sum;
    }
@@ -67,27 +91,50 @@ double LL(const std::string &mod, const std::vector<std::string> &fasta, const a
   double ll = 0.0;
   int k = alpha.n_cols;
   int n = fasta.size();
-  int t = fasta[0].size();
-  int m = t - k + 1;
+  
+  const arma::mat alphalog = arma::log(alpha);
+  arma::vec lo;
   
   for (int i = 0; i < n; ++i) {
    const auto &seq = fasta[i];
+   const int t = seq.size();
+   const int m = t - k + 1;
+   if (m <= 0) continue;
+   lo.set_size(m);
+   const arma::vec prefix = backgroundPrefix(seq, beta);
+   for (int j = 0; j < m; ++j) lo[j] = logOdds(seq, alphalog, prefix, j);
+   
+   // P(seq | j) = P(seq | beta) * odds(j), so the background of the whole sequence is factored out
    double intern_sum = 0.0;
-   for (int j = 0; j < m; ++j) {
-     if (mod == "OOPS") {
-       intern_sum += probSeqGivenPos(seq, alpha, beta, j);
-     }
-     
-     else if (mod == "ZOOPS") {
-       intern_sum += w * probSeqGivenPos(seq, alpha, beta, j) + (1-w) * probSeqGivenBeta(seq, beta);
+   
+   if (mod == "OOPS") {
+     const double mx = lo.max();
+     for (int j = 0; j < m; ++j) intern_sum += std::exp(lo[j] - mx);
+     ll += prefix[t] + mx + std::log(intern_sum);
+   }
+   
+   else if (mod == "ZOOPS") {
+     // m * (1-w) + sum_j w * odds(j), shifted by its largest term as in OOPS
+     const double rest = std::log(m) + std::log1p(-w);
+     const double mx = std::max(std::log(w) + lo.max(), rest);
+     for (int j = 0; j < m; ++j) intern_sum += std::exp(std::log(w) + lo[j] - mx);
+     intern_sum += std::exp(rest - mx);
+     ll += prefix[t] + mx + std::log(intern_sum);
+   }
+   
+   else if (mod == "ANR") {
+     // sum_j P(kmer j | beta) * (w * odds(j) + 1-w), each term split in two and shifted by the largest
+     double mx = -arma::datum::inf;
+     for (int j = 0; j < m; ++j) {
+       const double kmerlog = prefix[j + k] - prefix[j];
+       mx = std::max(mx, kmerlog + std::max(std::log(w) + lo[j], std::log1p(-w)));
      }
-     
-     else if (mod == "ANR") {
-       const auto &kmer = seq.substr(j, k);
-       intern_sum += w * probSeqGivenAlpha(kmer, alpha) + (1-w) * probSeqGivenBeta(kmer, beta);
+     for (int j = 0; j < m; ++j) {
+       const double kmerlog = prefix[j + k] - prefix[j];
+       intern_sum += std::exp(kmerlog + std::log(w) + lo[j] - mx) + std::exp(kmerlog + std::log1p(-w) - mx);
      }
+     ll += mx + std::log(intern_sum);
    }
-   ll += std::log(intern_sum);
   }
   
   return ll;
@@ -100,11 +147,10 @@ double LL(const std::string &mod, const std::vector<std::string> &fasta, const a
 //'@return The Markov Model of tau-order.
 arma::mat createMarkovChain(const std::vector<std::string> &fasta, const int tau = 0) {
  arma::mat markov(std::pow(4, tau), 4);
- int t = fasta[0].size();
  int k = tau + 1;
- int m = t - k + 1;
  
  for (const auto &seq : fasta) {
+   int m = seq.size() - k + 1;
    for (int j = 0; j < m; ++j) {
      const auto &kmer = seq.substr(j, k);
      int row = kmer2index(kmer.substr(0, k-1));
@@ -113,13 +159,182 @@ arma::mat createMarkovChain(const std::vector<std::string> &fasta, const int tau
    }
  }
  
+ // Contexts absent from the dataset get a uniform row
  for (int i = 0; i < std::pow(4, tau); ++i) {
-   markov.row(i) = markov.row(i) / arma::accu(markov.row(i));
+   const double total = arma::accu(markov.row(i));
+   if (total > 0) markov.row(i) = markov.row(i) / total;
+   else markov.row(i).fill(0.25);
  }
  
  return markov; 
 }
  
+//'Create tau-order Markov Chain streaming the dataset from disk.
+//'@name streamMarkovChain
+//'@param filepath Path to fasta dataset.
+//'@param tau The order of markov chain.
+//'@param batch Number of sequences in memory at a time.
+//'@return The Markov Model of tau-order.
+arma::mat streamMarkovChain(const std::string &filepath, const int tau, const size_t batch) {
+  arma::mat markov(std::pow(4, tau), 4);
+  FastaReader reader;
+  if (!openFasta(reader, filepath)) throw std::invalid_argument("Arquivo fasta não encontrado: " + filepath);
+  
+  // Whole genomes: records are tiled and split at N, each transition is counted once
+  reader.tile = TILE_SIZE;
+  reader.overlap = tau;
+  
+  std::vector<std::string> fasta;
+  while (readFastaBatch(reader, batch, fasta) > 0) {
+    for (const auto &seq : fasta) {
+      for (int j = 0; j + tau < int(seq.size()); ++j) {
+        int row = kmer2index(seq.substr(j, tau));
+        int col = char2int(seq[j + tau]);
+        markov(row, col) += 1;
+      }
+    }
+  }
+  
+  // Contexts absent from the dataset get a uniform row
+  for (int i = 0; i < std::pow(4, tau); ++i) {
+    const double total = arma::accu(markov.row(i));
+    if (total > 0) markov.row(i) = markov.row(i) / total;
+    else markov.row(i).fill(0.25);
+  }
+  
+  return markov;
+}
+
+//'Fingerprint of the fasta a background cache was built from: its absolute path, size
+//'and modification time in nanoseconds.
+//'@name sourceFingerprint
+//'@param filepath Path to fasta dataset.
+//'@return One line with the fingerprint, empty if the file can not be stat'ed.
+static std::string sourceFingerprint(const std::string &filepath) {
+  struct stat st;
+  if (stat(filepath.c_str(), &st) != 0) return "";
+  
+  std::error_code error;
+  const std::string path = std::filesystem::weakly_canonical(filepath, error).string();
+  return (error ? filepath : path) + "\t" + std::to_string(st.st_size) + "\t" + std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec);
+}
+
+//'Load a tau-order Markov Chain from a cache file, or create it streaming the dataset and
+//'save it in the cache. The same cache can be reused by all runs over the same genome.
+//'The fingerprint of the fasta is saved next to the matrix, in cache.src, and a cache
+//'whose fingerprint differs from the current fasta is rebuilt.
+//'@name cachedMarkovChain
+//'@param cache Path to the cache file.
+//'@param filepath Path to fasta dataset, only read if the cache is missing, stale or has another order.
+//'@param tau The order of markov chain.
+//'@return The Markov Model of tau-order.
+arma::mat cachedMarkovChain(const std::string &cache, const std::string &filepath, const int tau) {
+  const std::string fingerprint = sourceFingerprint(filepath);
+  std::string saved;
+  std::ifstream source(cache + ".src");
+  std::getline(source, saved);
+  
+  arma::mat markov;
+  if (!fingerprint.empty() && saved == fingerprint && markov.load(cache) && markov.n_rows == std::pow(4, tau) && markov.n_cols == 4) return markov;
+  
+  markov = streamMarkovChain(filepath, tau, BG_BATCH);
+  if (!markov.save(cache, arma::arma_binary) || !(std::ofstream(cache + ".src") << fingerprint << "\n")) {
+    std::cerr << "Não foi possível salvar o background em " << cache << "\n";
+  }
+  
+  return markov;
+}
+
+//'Order of a Markov Chain from its number of contexts.
+//'@name markovOrder
+//'@param beta Markov Chain with 4^tau rows.
+//'@return The order tau.
+int markovOrder(const arma::mat &beta) {
+  int tau = 0;
+  while ((size_t(1) << (2 * tau)) < beta.n_rows) ++tau;
+  return tau;
+}
+
+//'Conditional log-probabilities of a tau-order Markov Chain for every order up to tau.
+//'The first tau symbols of a sequence do not have a full context, so symbol j < tau uses
+//'the table of order j. Lower orders are the tau-order chain marginalized over the
+//'stationary distribution of its contexts.
+//'@name backgroundTables
+//'@param beta Markov Chain with 4^tau rows.
+//'@return Table j has 4^j rows, indexed by the last j symbols, and the log-probability of each symbol.
+std::vector<arma::mat> backgroundTables(const arma::mat &beta) {
+  const int tau = markovOrder(beta);
+  const size_t contexts = beta.n_rows;
+  if (tau == 0) return {arma::log(beta)};
+  
+  /**
+   * Stationary distribution of the contexts by power iteration
+   */
+  std::vector<double> pi(contexts, 1.0 / contexts);
+  std::vector<double> next(contexts);
+  for (int iter = 0; iter < 1000; ++iter) {
+    std::fill(next.begin(), next.end(), 0.0);
+    for (size_t c = 0; c < contexts; ++c) {
+      for (int x = 0; x < 4; ++x) next[((c << 2) | x) & (contexts - 1)] += pi[c] * beta(c, x);
+    }
+    double change = 0.0;
+    for (size_t c = 0; c < contexts; ++c) change += std::abs(next[c] - pi[c]);
+    pi.swap(next);
+    if (change < 1e-12) break;
+  }
+  
+  /**
+   * Marginal tables, the last symbols of a context are its low bits
+   */
+  std::vector<arma::mat> tables(tau + 1);
+  for (int o = 0; o <= tau; ++o) {
+    const size_t rows = size_t(1) << (2 * o);
+    arma::mat table(rows, 4, arma::fill::zeros);
+    for (size_t c = 0; c < contexts; ++c) {
+      for (int x = 0; x < 4; ++x) table(c & (rows - 1), x) += pi[c] * beta(c, x);
+    }
+    for (size_t r = 0; r < rows; ++r) {
+      const double total = arma::accu(table.row(r));
+      for (int x = 0; x < 4; ++x) table(r, x) = total > 0 ? std::log(std::max(table(r, x) / total, 1e-300)) : std::log(0.25);
+    }
+    tables[o] = table;
+  }
+  
+  return tables;
+}
+
+//'Prefix sums of the background log-probabilities of one encoded sequence.
+//'@name fillPrefix
+//'@param seq Symbol codes of the sequence.
+//'@param t Size of the sequence.
+//'@param tables Tables of backgroundTables.
+//'@param prefix Output with t+1 values.
+static void fillPrefix(const uint8_t *seq, const int t, const std::vector<arma::mat> &tables, double *prefix) {
+  const int tau = tables.size() - 1;
+  const size_t mask = (size_t(1) << (2 * tau)) - 1;
+  size_t context = 0;
+  prefix[0] = 0.0;
+  for (int j = 0; j < t; ++j) {
+    const arma::mat &table = tables[std::min(j, tau)];
+    prefix[j + 1] = prefix[j] + table(context & (table.n_rows - 1), seq[j]);
+    context = ((context << 2) | seq[j]) & mask;
+  }
+}
+
+//'Background log-probability of a kmer index.
+//'@name backgroundLog
+//'@param code Kmer index, 2 bits per symbol, first symbol in the high bits.
+//'@param k Size of the kmer.
+//'@param tables Tables of backgroundTables.
+//'@return The log-probability of the kmer given the Markov model.
+double backgroundLog(const uint64_t code, const int k, const std::vector<arma::mat> &tables) {
+  std::vector<uint8_t> seq(k);
+  for (int l = 0; l < k; ++l) seq[l] = (code >> (2 * (k - 1 - l))) & 3;
+  std::vector<double> prefix(k + 1);
+  fillPrefix(seq.data(), k, tables, prefix.data());
+  return prefix[k];
+}
+
 //'Computes de probability of a sequence give the alpha model.
 //'@name probSeqGivenAlpha
 //'@param kmer Sequence with k size.
@@ -162,63 +377,72 @@ double probSeqGivenAlphaLog(const std::string &kmer, const arma::mat &alpha) {
 //'@param beta Markov Chain.
 //'@return The probability of sequence given the Markov model. 
 double probSeqGivenBeta(const std::string &seq, const arma::mat &beta) {
- double prob = 1.0;
- auto t = seq.size();
- 
- for (int j = 0; j < t; ++j) {
-    int col = 0;
-    switch(seq[j]) {
-      case 'A':
-        col = 0;
-        break;
-      case 'C':
-        col = 1;
-        break;
-      case 'G':
-        col = 2;
-        break;
-      case 'T':
-        col = 3;
-        break;
-    }
-   prob *= beta(0, col);
- }
- 
- return prob;
+  return std::exp(probSeqGivenBetaLog(seq, beta));
 }
 
-//'Computes de probability of a sequence give the beta model.
-//'@name probSeqGivenBeta
+//'Computes de log-probability of a sequence give the beta model.
+//'@name probSeqGivenBetaLog
 //'@param seq Sequence with k size.
 //'@param beta Markov Chain.
-//'@return The probability of sequence given the Markov model. 
+//'@return The log-probability of sequence given the Markov model. 
 double probSeqGivenBetaLog(const std::string &seq, const arma::mat &beta) {
-  double prob = 0.0;
-  auto k = beta.n_cols;
-  auto t = seq.size();
-  auto m = t - k + 1;
-  arma::mat betalog = arma::log(beta);
+  return backgroundPrefix(seq, beta)[seq.size()];
+}
+
+//'Prefix sums of the background log-probabilities of each position of a sequence.
+//'@name backgroundPrefix
+//'@param seq Sequence.
+//'@param beta Markov Chain.
+//'@return Vector with t+1 elements, prefix[j] is the log-probability of seq[0, j).
+//'The background of the whole sequence is prefix[t] and of the kmer at j is prefix[j+k] - prefix[j].
+arma::vec backgroundPrefix(const std::string &seq, const arma::mat &beta) {
+  const int t = seq.size();
+  const std::vector<arma::mat> tables = backgroundTables(beta);
   
-  for (int j = 0; j < m; ++j) {
-    int col = 0;
-    switch(seq[j]) {
-    case 'A':
-      col = 0;
-      break;
-    case 'C':
-      col = 1;
-      break;
-    case 'G':
-      col = 2;
-      break;
-    case 'T':
-      col = 3;
-      break;
-    }
-    prob += beta(0, col);
-  }
+  std::vector<uint8_t> codes(t);
+  for (int j = 0; j < t; ++j) codes[j] = char2int(seq[j]);
+  
+  arma::vec prefix(t + 1);
+  fillPrefix(codes.data(), t, tables, prefix.memptr());
+  
+  return prefix;
+}
+
+//'Precompute the background prefix sums of all sequences, once per EM run.
+//'@name backgroundPrefixes
+//'@param fasta Encoded dataset of sequences.
+//'@param beta Markov Chain.
+//'@return Flat prefix sums, t+1 values for each sequence.
+Background backgroundPrefixes(const EncodedFasta &fasta, const arma::mat &beta) {
+  const size_t n = fasta.size();
+  const std::vector<arma::mat> tables = backgroundTables(beta);
+  
+  Background bg;
+  bg.starts.resize(n);
+  for (size_t i = 0; i < n; ++i) bg.starts[i] = fasta.offsets[i] + i;
+  bg.prefix.resize(fasta.codes.size() + n);
+  
+  tbb::parallel_for(size_t(0), n, [&](size_t i) {
+    fillPrefix(fasta.seq(i), fasta.length(i), tables, bg.prefix.data() + bg.starts[i]);
+  });
   
-  return prob;
+  return bg;
+}
+
+//'Log-odds of the kmer at a position of the sequence, motif against background.
+//'@name logOdds
+//'@param seq Sequence.
+//'@param alphalog Log of the PWM model.
+//'@param prefix Background prefix sums of seq.
+//'@param pos Position of the kmer.
+//'@return log P(kmer | alpha) - log P(kmer | beta). log P(seq | pos) is prefix[t] plus this value.
+double logOdds(const std::string &seq, const arma::mat &alphalog, const arma::vec &prefix, const int pos) {
+  const int k = alphalog.n_cols;
+  double score = 0.0;
+  for (int l = 0; l < k; ++l) {
+    score += alphalog(char2int(seq[pos + l]), l);
+  }
+  return score - (prefix[pos + k] - prefix[pos]);
 }
 
 //'Computes de probability of a sequence give the position.
@@ -244,10 +468,237 @@ double probSeqGivenPos(const std::string &seq, const arma::mat &alpha, const arm
 //'@return The probability of sequence given the position. 
 
 double probSeqGivenPosLog(const std::string &seq, const arma::mat &alpha, const arma::mat &beta, const int pos) {
- int k = alpha.n_cols;
- const auto &kmer = seq.substr(pos, k);
- double q = probSeqGivenBetaLog(seq, beta);
- return probSeqGivenAlphaLog(kmer, alpha) + (q - probSeqGivenBetaLog(kmer, beta));
+ const arma::vec prefix = backgroundPrefix(seq, beta);
+ return prefix[seq.size()] + logOdds(seq, arma::log(alpha), prefix, pos);
+}
+
+//'Log-odds of the kmer at a position of an encoded sequence, motif against background.
+//'@name logOdds
+//'@param seq Encoded sequence.
+//'@param alphalog Log of the PWM model, computed once per iteration.
+//'@param prefix Background prefix sums of seq.
+//'@param pos Position of the kmer.
+//'@return log P(kmer | alpha) - log P(kmer | beta).
+double logOdds(const uint8_t *seq, const arma::mat &alphalog, const double *prefix, const int pos) {
+  const int k = alphalog.n_cols;
+  const double *a = alphalog.memptr();
+  double score = 0.0;
+  for (int l = 0; l < k; ++l) {
+    score += a[4 * l + seq[pos + l]];
+  }
+  return score - (prefix[pos + k] - prefix[pos]);
+}
+
+//'Posterior probabilities of the motif positions of one sequence under ANR, where
+//'each position is a site with probability w independently of the others.
+//'@name anrPosterior
+//'@param seq Encoded sequence.
+//'@param prefix Background prefix sums of seq.
+//'@param t Size of the sequence.
+//'@param alphalog Log-PWM, column major 4 x k.
+//'@param k Size of the motif.
+//'@param w Priori probability of each position be a site.
+//'@param overlap Scale the posteriors so that any k consecutive positions sum at most 1.
+//'This is a heuristic, not the exact ANR constraint of non overlapping sites: each window
+//'gets the scale 1/sum from the unscaled posteriors, and each position takes the smallest
+//'scale of the windows it belongs to, so the result does not depend on the scan order.
+//'@param z Receives the t-k+1 posteriors, 2(t-k+1) doubles with overlap, the second half is scratch.
+//'@return Log-likelihood of the sequence relative to the background.
+double anrPosterior(const uint8_t *seq, const double *prefix, const int t, const double *alphalog, const int k, const double w, const bool overlap, double *z) {
+  const int m = t - k + 1;
+  
+  // PWM scores of all windows, then log-odds against the background
+  pwmScores(seq, m, alphalog, k, z);
+  
+  // Posterior as a logistic of the log-odds, and log(w e^lo + 1 - w) shifted by its max,
+  // exp(lo) alone overflows when the background has clamped transitions
+  const double prior = std::log1p(-w) - std::log(w);
+  double ll = 0.0;
+  for (int j = 0; j < m; ++j) {
+    const double x = z[j] - (prefix[j + k] - prefix[j]) - prior;
+    z[j] = 1 / (1 + std::exp(-x));
+    ll += std::log1p(-w) + (x > 0 ? x + std::log1p(std::exp(-x)) : std::log1p(std::exp(x)));
+  }
+  
+  // Overlapping sites can not both be real
+  if (overlap) {
+    double *scale = z + m;
+    for (int j = 0; j < m; ++j) {
+      const int last = std::min(j + k, m);
+      double sum = 0.0;
+      for (int l = j; l < last; ++l) sum += z[l];
+      scale[j] = sum > 1.0 ? 1.0 / sum : 1.0;
+    }
+    for (int l = 0; l < m; ++l) {
+      double factor = 1.0;
+      for (int j = std::max(0, l - k + 1); j <= l; ++j) factor = std::min(factor, scale[j]);
+      z[l] *= factor;
+    }
+  }
+  
+  return ll;
+}
+
+//'Allocate the E-step accumulators for a dataset.
+//'@name createWorkspace
+//'@param fasta Encoded dataset of sequences.
+//'@param k Size of the motif.
+//'@param strands STRAND_FORWARD, STRAND_BOTH or STRAND_PALINDROME.
+//'@return One accumulator for each chunk of up to EM_CHUNK sequences of similar length.
+EMWorkspace createWorkspace(const EncodedFasta &fasta, const int k, const int strands) {
+  const std::vector<size_t> lengths = sequenceLengths(fasta);
+  
+  EMWorkspace ws;
+  ws.order = lengthOrder(lengths, k);
+  ws.bounds = lengthBatches(lengths, ws.order, k, EM_CHUNK);
+  const size_t nchunks = ws.bounds.empty() ? 0 : ws.bounds.size() - 1;
+  
+  // Posteriors sized by the longest sequence of each chunk
+  ws.z.resize(nchunks);
+  for (size_t c = 0; c < nchunks; ++c) {
+    size_t t = k;
+    for (size_t p = ws.bounds[c]; p < ws.bounds[c + 1]; ++p) t = std::max(t, lengths[ws.order[p]]);
+    ws.z[c].resize(2 * (t - k + 1));
+  }
+  
+  ws.counts.assign(nchunks, arma::mat(4, k, arma::fill::zeros));
+  ws.sumz.assign(nchunks, 0.0);
+  ws.ll.assign(nchunks, 0.0);
+  ws.strands = strands;
+  if (strands != STRAND_FORWARD) {
+    ws.counts_rc.assign(nchunks, arma::mat(4, k, arma::fill::zeros));
+    ws.alphalog_rc.set_size(4, k);
+    ws.rc.set_size(4, k);
+  }
+  
+  return ws;
+}
+
+//'Posterior distribution of the motif positions of one sequence. With alphalog_rc both
+//'strands of each window are scored, each with half of the priori probability, and z
+//'holds the forward posteriors followed by the reverse ones.
+//'@name posterior
+//'@param seq Encoded sequence.
+//'@param prefix Background prefix sums of seq.
+//'@param t Size of the sequence.
+//'@param alphalog Log-PWM, column major 4 x k.
+//'@param alphalog_rc Reverse complement of alphalog, nullptr to score only the forward strand.
+//'@param k Size of the motif.
+//'@param w Priori probability of the motif positions.
+//'@param zoops Add the probability of a sequence without motif.
+//'@param logspace Normalize the posteriors in log space.
+//'@param z Receives the t-k+1 posteriors of each strand.
+//'@return Log normalizer of the sequence relative to the background.
+double posterior(const uint8_t *seq, const double *prefix, const int t, const double *alphalog, const double *alphalog_rc, const int k, const double w, const bool zoops, const bool logspace, double *z) {
+  const int m = t - k + 1;
+  const int strands = alphalog_rc ? 2 : 1;
+  const double ws = w / strands;
+  
+  // PWM scores of all windows on each strand, then log-odds against the background
+  pwmScores(seq, m, alphalog, k, z);
+  if (alphalog_rc) pwmScores(seq, m, alphalog_rc, k, z + m);
+  
+  // zoops, P(seq | beta) cancels with the motif positions
+  double marginal = 0.0;
+  double lognorm = 0.0;
+  
+  if (logspace) {
+    const double logw = std::log(ws);
+    double q = zoops ? std::log(m) + std::log(1-w) : -std::numeric_limits<double>::infinity();
+    double mx = q;
+    for (int s = 0; s < strands; ++s) {
+      double *zs = z + s * m;
+      for (int j = 0; j < m; ++j) {
+        zs[j] += logw - (prefix[j + k] - prefix[j]);
+        mx = std::max(mx, zs[j]);
+      }
+    }
+    for (int j = 0; j < strands * m; ++j) {
+      z[j] = std::exp(z[j] - mx);
+      marginal += z[j];
+    }
+    if (zoops) marginal += std::exp(q - mx);
+    lognorm = mx + std::log(marginal);
+  }
+  
+  else {
+    for (int s = 0; s < strands; ++s) {
+      double *zs = z + s * m;
+      for (int j = 0; j < m; ++j) {
+        zs[j] = ws * std::exp(zs[j] - (prefix[j + k] - prefix[j]));
+        marginal += zs[j];
+      }
+    }
+    if (zoops) marginal += m * (1-w);
+    lognorm = std::log(marginal);
+  }
+  
+  for (int j = 0; j < strands * m; ++j) z[j] /= marginal;
+  
+  return lognorm;
+}
+
+//'E-step and M-step counts of one iteration, parallel across sequences.
+//'@name estep
+//'@param fasta Encoded dataset of sequences.
+//'@param bg Background prefix sums of the dataset.
+//'@param alphalog Log of the PWM model.
+//'@param w Priori probability of the motif positions.
+//'@param zoops Add the probability of a sequence without motif.
+//'@param logspace Normalize the posteriors in log space.
+//'@param ws Accumulators from createWorkspace, also sets the strands scored.
+//'@param new_alpha Receives the expected symbol counts.
+//'@param new_w Receives the sum of the posteriors.
+//'@return Log-likelihood of the dataset relative to the background, sum of the log normalizers.
+double estep(const EncodedFasta &fasta, const Background &bg, const arma::mat &alphalog, const double w, const bool zoops, const bool logspace, EMWorkspace &ws, arma::mat &new_alpha, double &new_w) {
+  const int k = alphalog.n_cols;
+  const size_t nchunks = ws.counts.size();
+  const bool both = ws.strands != STRAND_FORWARD;
+  if (both) alpha2rc(alphalog, ws.alphalog_rc);
+  
+  tbb::parallel_for(size_t(0), nchunks, [&](size_t c) {
+    arma::mat &counts = ws.counts[c];
+    double *z = ws.z[c].data();
+    double sumz = 0.0;
+    double ll = 0.0;
+    counts.zeros();
+    if (both) ws.counts_rc[c].zeros();
+    
+    for (size_t p = ws.bounds[c]; p < ws.bounds[c + 1]; ++p) {
+      const size_t i = ws.order[p];
+      const uint8_t *seq = fasta.seq(i);
+      const double *prefix = bg.seq(i);
+      const int t = fasta.length(i);
+      const int m = t - k + 1;
+      
+      ll += posterior(seq, prefix, t, alphalog.memptr(), both ? ws.alphalog_rc.memptr() : nullptr, k, w, zoops, logspace, z);
+      for (int j = 0; j < (both ? 2 * m : m); ++j) sumz += z[j];
+      update(counts, seq, t, z);
+      if (both) update(ws.counts_rc[c], seq, t, z + m);
+    }
+    
+    ws.sumz[c] = sumz;
+    ws.ll[c] = ll;
+  });
+  
+  // Fold chunks in order, reverse sites back to the forward orientation
+  double ll = 0.0;
+  for (size_t c = 0; c < nchunks; ++c) {
+    new_alpha += ws.counts[c];
+    if (both) {
+      alpha2rc(ws.counts_rc[c], ws.rc);
+      new_alpha += ws.rc;
+    }
+    new_w += ws.sumz[c];
+    ll += ws.ll[c];
+  }
+  if (ws.strands == STRAND_PALINDROME) {
+    alpha2rc(new_alpha, ws.rc);
+    new_alpha += ws.rc;
+    new_alpha /= 2;
+  }
+  
+  return ll;
 }
 
 //'Compute information content.
@@ -262,14 +713,61 @@ double computeIC(const arma::mat &alpha, const arma::mat &beta) {
  return arma::accu(alpha % result);
 }
 
+//'Reverse complement of a PWM model, alpha_rc(c, l) = alpha(3 - c, k - 1 - l).
+//'@name alpha2rc
+//'@param alpha PWM model.
+//'@return PWM model of the reverse strand.
+arma::mat alpha2rc(const arma::mat &alpha) {
+  arma::mat rc(4, alpha.n_cols);
+  alpha2rc(alpha, rc);
+  
+  return rc;
+}
+
+//'Reverse complement of a PWM model into a preallocated matrix, for the EM iterations.
+//'@name alpha2rc
+//'@param alpha PWM model.
+//'@param rc Receives the model of the reverse strand, 4 x k and not the same matrix as alpha.
+void alpha2rc(const arma::mat &alpha, arma::mat &rc) {
+  const int k = alpha.n_cols;
+  for (int l = 0; l < k; ++l) {
+    for (int c = 0; c < 4; ++c) rc(c, l) = alpha(3 - c, k - 1 - l);
+  }
+}
+
+//'Log of a PWM model into a preallocated matrix, for the EM iterations.
+//'@name logModel
+//'@param alpha PWM model.
+//'@param alphalog Receives the log-PWM, same size as alpha.
+void logModel(const arma::mat &alpha, arma::mat &alphalog) {
+  const double *a = alpha.memptr();
+  double *out = alphalog.memptr();
+  for (size_t i = 0; i < alpha.n_elem; ++i) out[i] = std::log(a[i]);
+}
+
+//'M-step of the EM iterations in place: expected counts divided by the total of a column,
+//'every column has the same total.
+//'@name normalizeModel
+//'@param counts Expected symbol counts, 4 x k.
+//'@param alpha Receives the PWM model, same size as counts, may be counts itself.
+void normalizeModel(const arma::mat &counts, arma::mat &alpha) {
+  const double *c = counts.memptr();
+  double *out = alpha.memptr();
+  const double total = c[0] + c[1] + c[2] + c[3];
+  for (size_t i = 0; i < counts.n_elem; ++i) out[i] = c[i] / total;
+}
+
 //'Compute information content from a uniform distribution.
 //'@name computeICU
 //'@param alpha PWM model.
 //'@return Information content score.
 double computeICU(const arma::mat &alpha) {
  int k = alpha.n_cols;
+ const double *a = alpha.memptr();
+ double ic = 2.0*k;
+ for (size_t i = 0; i < alpha.n_elem; ++i) ic += a[i] * std::log2(a[i]);
  
- return 2.0*k + arma::accu(alpha % arma::log2(alpha));
+ return ic;
 }
 
 //'Update the alpha model with all kmers in the sequence.
@@ -306,6 +804,25 @@ void update(arma::mat &alpha, const std::string &seq, const arma::rowvec &poster
  }
 }
 
+//'Update the alpha model with all kmers of an encoded sequence.
+//'@name update
+//'@param alpha PWM model.
+//'@param seq Encoded sequence.
+//'@param t Size of the sequence.
+//'@param posteriori All kmers posteriori distribution.
+void update(arma::mat &alpha, const uint8_t *seq, const int t, const double *posteriori) {
+ int k = alpha.n_cols;
+ int m = t - k + 1;
+ double *a = alpha.memptr();
+ 
+ for (int i = 0; i < m; ++i) {
+   const double z = posteriori[i];
+   for (int j = 0; j < k; ++j) {
+     a[4 * j + seq[i + j]] += z;
+   }
+ }
+}
+
 //'Update the alpha model with all kmers in the sequence.
 //'@name hard_update
 //'@param alpha PWM model.
@@ -324,9 +841,10 @@ void hard_update(arma::mat &alpha, const std::string &seq, const arma::rowvec &p
 
 //'Convert kmers to PWM model.
 //'@name kmers2alpha
-//'@param kmers Kmers to convert.
+//'@param kmers Kmers to convert, at least one.
 //'@return PWM model from kmers.
 arma::mat kmers2alpha(const std::vector<std::string> &kmers) {
+ if (kmers.empty()) throw std::invalid_argument("Nenhum kmer para criar o modelo");
  int k = kmers[0].size();
  int n = kmers.size();
  arma::mat alpha(4, k);
@@ -491,14 +1009,15 @@ arma::mat consensus2alpha(const std::string &consensus) {
 //'@param fasta Dataset of sequences.
 //'@return The best kmers from dataset with respect to alpha.
 std::vector<std::string> alpha2kmers(const arma::mat &alpha, const std::vector<std::string> &fasta) {
- int t = fasta[0].size();
  int k = alpha.n_cols;
- int m = t - k + 1;
  
  std::vector<std::string> kmers;
- arma::vec z(m);
+ arma::vec z;
  
  for(const auto &seq : fasta) {
+   int m = seq.size() - k + 1;
+   if (m <= 0) continue;
+   z.set_size(m);
    for (int j = 0; j < m; ++j) {
      const auto &kmer = seq.substr(j, k);
      z[j] = computeDKLU(alpha, kmer);
@@ -512,18 +1031,28 @@ std::vector<std::string> alpha2kmers(const arma::mat &alpha, const std::vector<s
  return kmers;
 }
 
+//'Whether the dataset has a kmer to seed a model, fasta2alpha needs one.
+//'@name hasKmers
+//'@param fasta Dataset of sequences.
+//'@param k Size of kmers.
+//'@return True if some sequence has size k or more.
+bool hasKmers(const std::vector<std::string> &fasta, const int k) {
+  for (const auto &seq : fasta) if (int(seq.size()) >= k) return true;
+  return false;
+}
+
 //'Create random initial PWM guess from fasta.
 //'@name fasta2kmers
-//'@param fasta Dataset of sequences.
+//'@param fasta Dataset of sequences, at least one of size k.
 //'@param k Size of kmers.
+//'@param gen Random generator, seeded by the caller so runs are reproducible.
 //'@return The best kmers from dataset with respect to alpha.
-arma::mat fasta2alpha(const std::vector<std::string> &fasta, const int k) {
-  int t = fasta[0].size();
-  int m = t - k + 1;
-  
+arma::mat fasta2alpha(const std::vector<std::string> &fasta, const int k, std::mt19937 &gen) {
   std::vector<std::string> kmers;
   for (const auto &seq : fasta) {
-    std::uniform_int_distribution<> distrib(0, m);
+    int m = seq.size() - k + 1;
+    if (m <= 0) continue;
+    std::uniform_int_distribution<> distrib(0, m - 1);
     int u = distrib(gen);
     const auto &kmer = seq.substr(u, k);
     kmers.push_back(kmer);
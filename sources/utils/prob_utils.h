@@ -4,23 +4,77 @@
 #include <vector>
 #include <stdexcept>
 #include<random>
+#include "utils.h"
+
+// Prefix sums of the background log-probabilities of an encoded dataset.
+// Sequence i has t+1 values starting at prefix[starts[i]].
+struct Background {
+  std::vector<double> prefix;
+  std::vector<size_t> starts;
+  
+  const double *seq(size_t i) const { return prefix.data() + starts[i]; }
+};
+
+#define EM_CHUNK 64
+#define BG_BATCH 10000    // Sequences in memory while a background is streamed
+#define MAX_TAU 5
+
+#define STRAND_FORWARD 0       // Score only the forward strand
+#define STRAND_BOTH 1          // Score both strands, reverse sites are counted in the forward orientation
+#define STRAND_PALINDROME 2    // Both strands, and the model is kept equal to its reverse complement
+
+// Accumulators of the E-step, allocated once per EM run. Sequences are grouped by
+// length bucket and split in chunks of up to EM_CHUNK, and the chunks are folded in
+// order, so the sums are the same for any number of threads.
+struct EMWorkspace {
+  std::vector<size_t> order;               // Sequence indexes grouped by length, from lengthOrder
+  std::vector<size_t> bounds;              // Chunk c is order[bounds[c], bounds[c+1])
+  std::vector<arma::mat> counts;           // Expected symbol counts of each chunk
+  std::vector<double> sumz;                // Sum of posteriors of each chunk
+  std::vector<double> ll;                  // Sum of log normalizers of each chunk
+  std::vector<arma::mat> counts_rc;        // Expected symbol counts of the reverse sites, in the forward orientation
+  std::vector<std::vector<double>> z;      // Posteriors of the current sequence of each chunk, forward then reverse
+  arma::mat alphalog_rc;                   // Reverse complement of the log-PWM of the iteration
+  arma::mat rc;                            // Reverse complement of the counts being folded
+  int strands = STRAND_FORWARD;
+};
 
 double computeICU(const arma::mat &alpha);
-double step_size(std::vector<double> convergence);
+double step_size(const std::vector<double> &convergence);
 double computeIC(const arma::mat &alpha, const arma::mat &beta);
 arma::mat kmers2alpha(const std::vector<std::string> &kmers);
 arma::mat consensus2alpha(const std::string &consensus);
 double probSeqGivenBeta(const std::string &seq, const arma::mat &beta);
 double probSeqGivenBetaLog(const std::string &seq, const arma::mat &beta);
+arma::vec backgroundPrefix(const std::string &seq, const arma::mat &beta);
+Background backgroundPrefixes(const EncodedFasta &fasta, const arma::mat &beta);
+double logOdds(const std::string &seq, const arma::mat &alphalog, const arma::vec &prefix, const int pos);
+double logOdds(const uint8_t *seq, const arma::mat &alphalog, const double *prefix, const int pos);
+double posterior(const uint8_t *seq, const double *prefix, const int t, const double *alphalog, const double *alphalog_rc, const int k, const double w, const bool zoops, const bool logspace, double *z);
+double anrPosterior(const uint8_t *seq, const double *prefix, const int t, const double *alphalog, const int k, const double w, const bool overlap, double *z);
+EMWorkspace createWorkspace(const EncodedFasta &fasta, const int k, const int strands);
+double estep(const EncodedFasta &fasta, const Background &bg, const arma::mat &alphalog, const double w, const bool zoops, const bool logspace, EMWorkspace &ws, arma::mat &new_alpha, double &new_w);
 double probSeqGivenAlpha(const std::string &kmer, const arma::mat &alpha);
-arma::mat fasta2alpha(const std::vector<std::string> &fasta, const int k);
+bool hasKmers(const std::vector<std::string> &fasta, const int k);
+arma::mat fasta2alpha(const std::vector<std::string> &fasta, const int k, std::mt19937 &gen);
 double probSeqGivenAlphaLog(const std::string &seq, const arma::mat &alpha);
 arma::mat createMarkovChain(const std::vector<std::string> &fasta, const int tau);
 void update(arma::mat &alpha, const std::string &seq, const arma::rowvec &posteriori);
+void update(arma::mat &alpha, const uint8_t *seq, const int t, const double *posteriori);
 void hard_update(arma::mat &alpha, const std::string &seq, const arma::rowvec &posteriori);
 double Q(const std::string &mod, const std::vector<std::string> &fasta, const arma::mat &alpha, const arma::mat &beta, const double w);
 double LL(const std::string &mod, const std::vector<std::string> &fasta, const arma::mat &alpha, const arma::mat &beta, const double w);
 std::vector<std::string> alpha2kmers(const arma::mat &alpha, const std::vector<std::string> &fasta);
 double probSeqGivenPos(const std::string &seq, const arma::mat &alpha, const arma::mat &beta, const int pos);
 double probSeqGivenPosLog(const std::string &seq, const arma::mat &alpha, const arma::mat &beta, const int pos);
-bool hasConverged(const double cutoff, const int niter, const arma::mat &alpha, std::vector<double> &convergence, std::vector<double> &changes);
\ No newline at end of file
+bool hasConverged(const double cutoff, const int niter, const arma::mat &alpha, std::vector<double> &convergence, std::vector<double> &changes);
+bool hasConvergedLL(const double cutoff, const int niter, const double ll, const size_t n, std::vector<double> &lls);
+arma::mat streamMarkovChain(const std::string &filepath, const int tau, const size_t batch);
+arma::mat cachedMarkovChain(const std::string &cache, const std::string &filepath, const int tau);
+int markovOrder(const arma::mat &beta);
+std::vector<arma::mat> backgroundTables(const arma::mat &beta);
+double backgroundLog(const uint64_t code, const int k, const std::vector<arma::mat> &tables);
+arma::mat alpha2rc(const arma::mat &alpha);
+void alpha2rc(const arma::mat &alpha, arma::mat &rc);
+void logModel(const arma::mat &alpha, arma::mat &alphalog);
+void normalizeModel(const arma::mat &counts, arma::mat &alpha);
@@ -0,0 +1,97 @@
+#include "pwm_kernels.h"
+#include <cstring>
+
+//'Score windows of an encoded sequence against a log-PWM.
+//'@name pwmScoresScalar
+//'@param seq Encoded sequence, at least m + k - 1 symbols.
+//'@param m Number of windows.
+//'@param alphalog Log-PWM, column major 4 x k.
+//'@param k Size of the motif.
+//'@param scores Receives the m window scores.
+void pwmScoresScalar(const uint8_t *seq, const int m, const double *alphalog, const int k, double *scores) {
+  for (int j = 0; j < m; ++j) {
+    double score = 0.0;
+    for (int l = 0; l < k; ++l) score += alphalog[4 * l + seq[j + l]];
+    scores[j] = score;
+  }
+}
+
+//'Score 4 windows per step with AVX2. The 4 log-probabilities of a motif position stay in
+//'registers and are selected by the symbol bits with in-lane permutes and a blend.
+//'@name pwmScoresAVX2
+//'@param seq Encoded sequence, at least m + k - 1 symbols.
+//'@param m Number of windows.
+//'@param alphalog Log-PWM, column major 4 x k.
+//'@param k Size of the motif.
+//'@param scores Receives the m window scores.
+__attribute__((target("avx2")))
+void pwmScoresAVX2(const uint8_t *seq, const int m, const double *alphalog, const int k, double *scores) {
+  int j = 0;
+  for (; j + 4 <= m; j += 4) {
+    __m256d acc = _mm256_setzero_pd();
+    for (int l = 0; l < k; ++l) {
+      int32_t symbols;
+      std::memcpy(&symbols, seq + j + l, sizeof(symbols));
+      const __m256i idx = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(symbols));
+      
+      // A,C in the low table and G,T in the high table, bit 0 selects inside, bit 1 between tables
+      const __m256d low = _mm256_broadcast_pd(reinterpret_cast<const __m128d*>(alphalog + 4 * l));
+      const __m256d high = _mm256_broadcast_pd(reinterpret_cast<const __m128d*>(alphalog + 4 * l + 2));
+      const __m256i inside = _mm256_slli_epi64(idx, 1);
+      const __m256d between = _mm256_castsi256_pd(_mm256_slli_epi64(idx, 62));
+      acc = _mm256_add_pd(acc, _mm256_blendv_pd(_mm256_permutevar_pd(low, inside), _mm256_permutevar_pd(high, inside), between));
+    }
+    _mm256_storeu_pd(scores + j, acc);
+  }
+  pwmScoresScalar(seq + j, m - j, alphalog, k, scores + j);
+}
+
+//'Score 8 windows per step with AVX-512, selecting the log-probabilities with a permute.
+//'@name pwmScoresAVX512
+//'@param seq Encoded sequence, at least m + k - 1 symbols.
+//'@param m Number of windows.
+//'@param alphalog Log-PWM, column major 4 x k.
+//'@param k Size of the motif.
+//'@param scores Receives the m window scores.
+__attribute__((target("avx512f")))
+void pwmScoresAVX512(const uint8_t *seq, const int m, const double *alphalog, const int k, double *scores) {
+  int j = 0;
+  for (; j + 8 <= m; j += 8) {
+    __m512d acc = _mm512_setzero_pd();
+    for (int l = 0; l < k; ++l) {
+      const __m512i idx = _mm512_cvtepu8_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(seq + j + l)));
+      const __m512d table = _mm512_broadcast_f64x4(_mm256_loadu_pd(alphalog + 4 * l));
+      acc = _mm512_add_pd(acc, _mm512_permutexvar_pd(idx, table));
+    }
+    _mm512_storeu_pd(scores + j, acc);
+  }
+  pwmScoresAVX2(seq + j, m - j, alphalog, k, scores + j);
+}
+
+//'Widest PWM kernel supported by the CPU, resolved once.
+//'@name pwmKernel
+//'@return Pointer to the kernel.
+PwmKernel pwmKernel() {
+  static const PwmKernel kernel = __builtin_cpu_supports("avx512f") ? pwmScoresAVX512 :
+                                  __builtin_cpu_supports("avx2") ? pwmScoresAVX2 : pwmScoresScalar;
+  return kernel;
+}
+
+//'Name of the kernel chosen by pwmKernel.
+//'@name pwmKernelName
+//'@return avx512, avx2 or scalar.
+const char *pwmKernelName() {
+  const PwmKernel kernel = pwmKernel();
+  return kernel == pwmScoresAVX512 ? "avx512" : kernel == pwmScoresAVX2 ? "avx2" : "scalar";
+}
+
+//'Score windows of an encoded sequence with the dispatched kernel.
+//'@name pwmScores
+//'@param seq Encoded sequence, at least m + k - 1 symbols.
+//'@param m Number of windows.
+//'@param alphalog Log-PWM, column major 4 x k.
+//'@param k Size of the motif.
+//'@param scores Receives the m window scores.
+void pwmScores(const uint8_t *seq, const int m, const double *alphalog, const int k, double *scores) {
+  pwmKernel()(seq, m, alphalog, k, scores);
+}
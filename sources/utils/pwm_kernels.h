@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <immintrin.h>
+
+// PWM scoring of every window of an encoded sequence. The log-PWM is column major,
+// 4 values per motif position, so the score of symbol c at position l is alphalog[4*l + c].
+// The widest kernel supported by the CPU is chosen at runtime, so the binaries do not
+// need -march=native.
+typedef void (*PwmKernel)(const uint8_t *seq, const int m, const double *alphalog, const int k, double *scores);
+
+void pwmScoresScalar(const uint8_t *seq, const int m, const double *alphalog, const int k, double *scores);
+void pwmScoresAVX2(const uint8_t *seq, const int m, const double *alphalog, const int k, double *scores);
+void pwmScoresAVX512(const uint8_t *seq, const int m, const double *alphalog, const int k, double *scores);
+PwmKernel pwmKernel();
+const char *pwmKernelName();
+void pwmScores(const uint8_t *seq, const int m, const double *alphalog, const int k, double *scores);
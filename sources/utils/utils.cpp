@@ -24,6 +24,36 @@ std::vector<std::string> getFilenames(const std::string& dirPath) {
  return filenames;
 }
 
+//'Read the PWM models of a directory, m1, m2, ... in numeric order. Logos and reports
+//'in the same directory (.png, .svg and .txt) are skipped.
+//'@name readModels
+//'@param dirPath Directory of the models, as saved by em.
+//'@param names Receives the file name of each model.
+//'@return Models 4 x k, empty if some file is not a valid model.
+std::vector<arma::mat> readModels(const std::string& dirPath, std::vector<std::string> &names) {
+  names.clear();
+  for (const auto &name : getFilenames(dirPath)) {
+    const std::string ext = name.size() > 4 ? name.substr(name.size() - 4) : "";
+    if (ext == ".png" || ext == ".svg" || ext == ".txt") continue;
+    names.push_back(name);
+  }
+  std::sort(names.begin(), names.end(), [](const std::string &a, const std::string &b) {
+    return a.size() != b.size() ? a.size() < b.size() : a < b;
+  });
+  
+  std::vector<arma::mat> models;
+  for (const auto &name : names) {
+    arma::mat alpha;
+    if (!alpha.load(dirPath + "/" + name, arma::csv_ascii) || alpha.n_rows != 4) {
+      std::cerr << "Modelo inválido: " << dirPath + "/" + name << "\n";
+      return {};
+    }
+    models.push_back(alpha);
+  }
+  
+  return models;
+}
+
 //'Read fasta dataset.
 //'@name readFasta
 //'@param filepath Path to fasta dataset.
@@ -54,6 +84,104 @@ std::vector<std::string> readFasta(const std::string& filepath) {
   return data;
 }
 
+//'Open a fasta dataset for streaming, or rewind it if already open.
+//'@name openFasta
+//'@param reader Reader to open.
+//'@param filepath Path to fasta dataset.
+//'@return True if the file was opened.
+bool openFasta(FastaReader &reader, const std::string &filepath) {
+  if (reader.file.is_open()) reader.file.close();
+  reader.file.clear();
+  reader.file.open(filepath);
+  reader.seq.clear();
+  reader.started = false;
+  reader.records = 0;
+  reader.coords.clear();
+  reader.names.clear();
+  
+  return reader.file.is_open();
+}
+
+//'Add the completed record of a reader to a batch, whole or in tiles.
+//'@name pushRecord
+//'@param reader Reader with a completed record in seq.
+//'@param batch Batch of sequences.
+static void pushRecord(FastaReader &reader, std::vector<std::string> &batch) {
+  if (reader.tile > 0) {
+    tileRecord(reader.seq, reader.records, reader.tile, reader.overlap, batch, reader.coords);
+  }
+  
+  else if (reader.seq.find('N') == std::string::npos) {
+    batch.push_back(reader.seq);
+  }
+  
+  ++reader.records;
+}
+
+//'Read the next sequences of a fasta dataset.
+//'@name readFastaBatch
+//'@param reader Open reader.
+//'@param n Max number of sequences to read, the tiles of the last record may exceed it.
+//'@param batch Sequences read, without the ones with N, or the tiles of the records.
+//'@return Number of sequences read, 0 at the end of the file.
+size_t readFastaBatch(FastaReader &reader, const size_t n, std::vector<std::string> &batch) {
+  batch.clear();
+  reader.coords.clear();
+  std::string line;
+  
+  while (batch.size() < n && std::getline(reader.file, line)) {
+    
+    if (line[0] == '>') {
+      if (reader.started) pushRecord(reader, batch);
+      reader.seq.clear();
+      reader.started = true;
+      reader.names.push_back(line.substr(1, line.find_first_of(" \t\r") - 1));
+    }
+    
+    else if (reader.started) {
+      reader.seq += line;
+    }
+  }
+  
+  // Last sequence of the file
+  if (batch.size() < n && reader.started && !reader.file) {
+    pushRecord(reader, batch);
+    reader.seq.clear();
+    reader.started = false;
+  }
+  
+  return batch.size();
+}
+
+//'Encode fasta dataset as contiguous symbol codes.
+//'@name encodeFasta
+//'@param fasta Dataset of sequences.
+//'@return Encoded dataset with the offsets of each sequence.
+EncodedFasta encodeFasta(const std::vector<std::string> &fasta) {
+  EncodedFasta data;
+  data.offsets.resize(fasta.size() + 1);
+  data.offsets[0] = 0;
+  for (size_t i = 0; i < fasta.size(); ++i) data.offsets[i + 1] = data.offsets[i] + fasta[i].size();
+  
+  data.codes.resize(data.offsets.back());
+  for (size_t i = 0; i < fasta.size(); ++i) {
+    uint8_t *codes = data.codes.data() + data.offsets[i];
+    for (size_t j = 0; j < fasta[i].size(); ++j) codes[j] = char2int(fasta[i][j]);
+  }
+  
+  return data;
+}
+
+//'Length of each sequence of the encoded dataset.
+//'@name sequenceLengths
+//'@param fasta Encoded dataset of sequences.
+//'@return Vector with the size of each sequence.
+std::vector<size_t> sequenceLengths(const EncodedFasta &fasta) {
+  std::vector<size_t> lengths(fasta.size());
+  for (size_t i = 0; i < fasta.size(); ++i) lengths[i] = fasta.length(i);
+  return lengths;
+}
+
 //'Converts char nucleotide A,C,G,T in int 0,1,2,3.
 //'@name char2int
 //'@param c char to convert for.
@@ -3,6 +3,36 @@
 #include <armadillo>
 #include <stdexcept>
 #include <boost/filesystem.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include "batches.h"
+
+// Dataset encoded once as symbol codes (A0 C1 G2 T3), one byte per symbol.
+// Sequences are stored back to back, sequence i is codes[offsets[i], offsets[i+1]).
+struct EncodedFasta {
+  std::vector<uint8_t> codes;
+  std::vector<size_t> offsets;
+  
+  size_t size() const { return offsets.size() - 1; }
+  const uint8_t *seq(size_t i) const { return codes.data() + offsets[i]; }
+  int length(size_t i) const { return offsets[i + 1] - offsets[i]; }
+};
+
+// Streaming reader of a fasta dataset, returns sequences in batches without
+// loading the whole file. Sequences with N are skipped as in readFasta, unless
+// tile is set, then records are split by tileRecord and no record is skipped.
+struct FastaReader {
+  std::ifstream file;
+  std::string seq;        // Sequence being read, completed by the next header
+  bool started = false;   // A header was read
+  size_t tile = 0;        // Max size of the tiles, 0 to return whole records
+  int overlap = 0;        // Symbols shared by consecutive tiles
+  uint32_t records = 0;   // Records completed, index of the next record
+  std::vector<TileCoord> coords;    // Position of each tile of the last batch, tile mode only
+  std::vector<std::string> names;   // Name of each record read, up to the first space
+};
 
 int char2int(char c);
 char int2char(int i);
@@ -15,8 +45,13 @@ double corr_freq(const std::string &correlation_str);
 std::string corr(const std::string &a, const std::string b);
 std::vector<std::string> readFasta(const std::string& filepath);
 std::vector<std::string> readFasta(const std::string& filepath);
+EncodedFasta encodeFasta(const std::vector<std::string> &fasta);
+std::vector<size_t> sequenceLengths(const EncodedFasta &fasta);
+bool openFasta(FastaReader &reader, const std::string &filepath);
+size_t readFastaBatch(FastaReader &reader, const size_t n, std::vector<std::string> &batch);
 double fast_corr_freq(const std::string &a, const std::string b);
 std::vector<std::string> getFilenames(const std::string& dirPath);
+std::vector<arma::mat> readModels(const std::string& dirPath, std::vector<std::string> &names);
 double computeDKLU(const arma::mat &alpha, const std::string &kmer);
 int hamming_distance_parallel(const std::string &str1, const std::string &str2);
 double computeDKL(const arma::mat &alpha, const arma::mat &beta, const std::string &kmer);